@@ -1,37 +1,112 @@
 #pragma once
 
+#include "EventDispatcher.h"
 #include <array>
 #include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <thread>
 #include <type_traits>
+#include <typeinfo>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 namespace CodeWizard::Core {
-// Event traits - user specializes this
+// What post() does when the ring is full
+enum class OverflowPolicy {
+  DropOldest,// Discard the oldest queued event to make room
+  DropNewest,// Discard the event being posted
+  Block,     // Wait for the consumer; on the bus's owner thread, drain in place
+  Coalesce   // Keep only the newest overflowing event, delivered after the queued ones
+};
+
+// Event traits - user specializes this. Optional members:
+//   static constexpr OverflowPolicy kOverflow (default DropOldest)
+//   static Key coalesceKey(const Ev &) - events with equal keys replace each
+//     other until the next poll(); they bypass the ring (Key needs std::hash)
 template<typename T> struct EventTraits
 {
   static constexpr bool kThreadSafe = false;
 };
 
-// Forward declarations
-template<typename Ev> class EventBus;
+template<typename Ev>
+concept KeyCoalesced = requires(const Ev &ev) { EventTraits<Ev>::coalesceKey(ev); };
 
-// Global event bus access
-template<typename Ev> static EventBus<Ev> &getEventBus()
+template<typename Ev> constexpr OverflowPolicy overflowPolicy()
 {
-  static EventBus<Ev> bus;
-  return bus;
+  if constexpr (requires { EventTraits<Ev>::kOverflow; }) {
+    return EventTraits<Ev>::kOverflow;
+  } else {
+    return OverflowPolicy::DropOldest;
+  }
 }
 
-// Main EventBus template - one per event type
-template<typename Ev> class EventBus
+// Latest event per key, in the order the keys first showed up since the
+// last take(). The mutex is held for a hash lookup and a move only.
+template<typename Ev> class CoalescingTable
+{
+public:
+  using Key = std::remove_cvref_t<decltype(EventTraits<Ev>::coalesceKey(std::declval<const Ev &>()))>;
+
+  // Returns true if an event with the same key was replaced; the key keeps
+  // the time it was first posted at
+  bool put(Ev &&ev, std::int64_t postedAt)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto [it, inserted] = index_.try_emplace(EventTraits<Ev>::coalesceKey(ev), events_.size());
+    if (!inserted) {
+      events_[it->second] = std::move(ev);
+      return true;
+    }
+    events_.push_back(std::move(ev));
+    postedAt_.push_back(postedAt);
+    return false;
+  }
+
+  // Swaps the pending events into `out` (cleared first, capacity kept)
+  void take(std::vector<Ev> &out, std::vector<std::int64_t> &postedAt)
+  {
+    out.clear();
+    postedAt.clear();
+    std::lock_guard<std::mutex> lock(mutex_);
+    out.swap(events_);
+    postedAt.swap(postedAt_);
+    index_.clear();
+  }
+
+  [[nodiscard]] size_t size() const
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return events_.size();
+  }
+
+private:
+  mutable std::mutex mutex_;
+  std::unordered_map<Key, size_t> index_;
+  std::vector<Ev> events_;
+  std::vector<std::int64_t> postedAt_;
+};
+
+struct NoCoalescingTable
+{};
+
+// Main EventBus template - one per event type. Each registers with the
+// EventDispatcher on first use, which delivers from the UI event loop.
+template<typename Ev> class EventBus final : public EventQueue
 {
 public:
-  // RAII subscription handle
+  // RAII subscription handle: a slot index and the slot's generation, so a
+  // stale handle can never remove the listener that reused its slot
   class Handle
   {
   public:
     Handle() = default;
-    explicit Handle(size_t id) : id_(id) {}
+    explicit Handle(std::uint64_t id) : id_(id) {}
     ~Handle()
     {
       if (id_ != 0) unsubscribe();
@@ -50,114 +125,411 @@ public:
     Handle &operator=(const Handle &) = delete;
 
   private:
-    void unsubscribe() { getEventBus<Ev>().unsubscribe(id_); }
-    size_t id_ = 0;
+    void unsubscribe() { instance().unsubscribe(id_); }
+    std::uint64_t id_ = 0;
   };
 
-  // Post event - lock-free if thread-safe
+  // Post event - lock-free unless the ring is full
   static void post(Ev &&ev)
   {
-    if constexpr (EventTraits<Ev>::kThreadSafe) {
-      instance().template push<true>(std::forward<Ev>(ev));
-    } else {
-      instance().template push<false>(std::forward<Ev>(ev));
-    }
+    instance().push(std::move(ev));
+    EventDispatcher::wake();
   }
 
   // Subscribe - returns RAII handle
   template<typename F> static Handle subscribe(F &&f) { return instance().template doSubscribe<F>(std::forward<F>(f)); }
 
-  // Poll - call from main thread
-  static void poll() { instance().drain(); }
+  // Batch subscribe: one call per contiguous run of pending events, read in
+  // place from the ring. A poll() makes one call per run, two where the
+  // ring wraps, plus one for coalesced events.
+  template<typename F> static Handle subscribeBatch(F &&f)
+  {
+    return instance().template doSubscribeBatch<F>(std::forward<F>(f));
+  }
+
+  // Poll - call from main thread. Normally the EventDispatcher does this.
+  static void poll() { instance().drain(std::chrono::steady_clock::time_point::max()); }
+
+  [[nodiscard]] static EventBusStats stats()
+  {
+    EventBus &bus = instance();
+    EventBusStats stats;
+    stats.posted    = bus.posted_.load(std::memory_order_relaxed);
+    stats.delivered = bus.delivered_.load(std::memory_order_relaxed);
+    stats.dropped   = bus.dropped_.load(std::memory_order_relaxed);
+    stats.coalesced = bus.coalesced_.load(std::memory_order_relaxed);
+    stats.highWater = bus.highWater_.load(std::memory_order_relaxed);
+    return stats;
+  }
+
+  // Time from post() to delivery of each event (of each key's first post, when coalesced)
+  [[nodiscard]] static const LatencyHistogram &latency() { return instance().latency_; }
+
+  bool pump(std::chrono::steady_clock::time_point deadline) override { return drain(deadline); }
+  [[nodiscard]] bool hasPending() const override
+  {
+    if (enqueuePos_.load(std::memory_order_acquire) != dequeuePos_.load(std::memory_order_acquire)) return true;
+    if (hasOverflow_.load(std::memory_order_acquire)) return true;
+    if constexpr (KeyCoalesced<Ev>) return coalescing_.size() > 0;
+    return false;
+  }
+  [[nodiscard]] const char *queueName() const override { return typeid(Ev).name(); }
+  [[nodiscard]] EventBusStats queueStats() const override { return stats(); }
+  [[nodiscard]] const LatencyHistogram &queueLatency() const override { return latency_; }
 
 private:
-  EventBus() = default;
+  EventBus()
+  {
+    for (size_t i = 0; i < kBufferSize; ++i) sequence_[i].store(i, std::memory_order_relaxed);
+    EventDispatcher::instance().add(this);
+  }
+  ~EventBus() override
+  {
+    EventDispatcher::instance().remove(this);
+    size_t first = 0;
+    while (size_t count = claim(kBufferSize, SIZE_MAX, first)) release(first, count);
+  }
   static EventBus &instance()
   {
     static EventBus bus;
     return bus;
   }
 
-  // Fixed-size ring buffer (power of 2)
-  static constexpr size_t kBufferSize = 1024;
+  // Bounded MPMC ring (Vyukov): slot i is free for the producer at position
+  // p when sequence_[i] == p, holds a published event when it is p + 1, and
+  // is free again for the next lap at p + kBufferSize. Positions only grow.
+  static constexpr size_t kBufferSize = 1024;// Power of 2
+  static constexpr size_t kMask       = kBufferSize - 1;
   alignas(64) std::array<std::aligned_storage_t<sizeof(Ev), alignof(Ev)>, kBufferSize> buffer_;
-  std::atomic<size_t> writeIndex_{ 0 };
-  std::atomic<size_t> readIndex_{ 0 };
+  std::array<std::atomic<size_t>, kBufferSize> sequence_;
+  std::array<std::int64_t, kBufferSize> postedAt_;// Published with the slot's sequence
+  alignas(64) std::atomic<size_t> enqueuePos_{ 0 };
+  alignas(64) std::atomic<size_t> dequeuePos_{ 0 };
+
+  // Coalesce policy: the newest event that did not fit
+  std::mutex overflowMutex_;
+  std::optional<Ev> overflow_;
+  std::int64_t overflowPostedAt_ = 0;
+  std::atomic<bool> hasOverflow_{ false };
+
+  // Keyed coalescing (EventTraits<Ev>::coalesceKey): replaces the ring
+  using Table = std::conditional_t<KeyCoalesced<Ev>, CoalescingTable<Ev>, NoCoalescingTable>;
+  [[no_unique_address]] Table coalescing_;
+  std::vector<Ev> coalescedBatch_;// Consumer-side buffers, reused across polls
+  std::vector<std::int64_t> coalescedPostedAt_;
+
+  std::atomic<std::thread::id> owner_{};// First thread that posted or polled; see isOwnerThread()
+
+  alignas(64) std::atomic<std::uint64_t> posted_{ 0 };
+  std::atomic<std::uint64_t> delivered_{ 0 };
+  std::atomic<std::uint64_t> dropped_{ 0 };
+  std::atomic<std::uint64_t> coalesced_{ 0 };
+  std::atomic<size_t> highWater_{ 0 };
+  LatencyHistogram latency_;
 
   // Callbacks
-  static constexpr size_t kMaxListeners = 64;
-  std::array<std::function<void(const Ev &)>, kMaxListeners> listeners_;
-  std::atomic<size_t> listenerCount_{ 0 };
-  std::mutex listenerMutex_;// Only used during subscribe/unsubscribe
-
-  // Thread-safe push
-  template<bool ThreadSafe> void push(Ev &&ev)
-  {
-    if constexpr (ThreadSafe) {
-      // Lock-free SPSC queue
-      size_t writeIdx = writeIndex_.load(std::memory_order_relaxed);
-      size_t nextWrite = (writeIdx + 1) & (kBufferSize - 1);
-
-      // Check for overflow (drop oldest)
-      if (nextWrite == readIndex_.load(std::memory_order_acquire)) {
-        readIndex_.fetch_add(1, std::memory_order_relaxed);// Drop oldest
+  struct Listener
+  {
+    std::function<void(const Ev &)> onEvent;// One of the two is set
+    std::function<void(std::span<const Ev>)> onBatch;
+    std::atomic<bool> active{ true };
+  };
+  // Copy-on-write: drain() loads the current set without a lock; subscribe
+  // and compaction publish a new one. Unsubscribed listeners only go
+  // inactive, so the set is rebuilt once they outnumber the live ones.
+  struct ListenerSet
+  {
+    std::vector<std::shared_ptr<Listener>> single;
+    std::vector<std::shared_ptr<Listener>> batch;
+  };
+  std::atomic<std::shared_ptr<const ListenerSet>> listeners_{ std::make_shared<const ListenerSet>() };
+
+  // Slot map behind the handles; freed slots are reused, their generation bumped
+  static constexpr std::uint32_t kNoSlot = UINT32_MAX;
+  struct Slot
+  {
+    std::shared_ptr<Listener> listener;
+    std::uint32_t generation = 1;
+    std::uint32_t nextFree   = kNoSlot;
+  };
+  std::vector<Slot> slots_;
+  std::uint32_t freeSlot_ = kNoSlot;
+  size_t liveListeners_   = 0;
+  size_t deadListeners_   = 0;// Inactive, still in the published set
+  std::mutex listenerMutex_;  // Only used during subscribe/unsubscribe
+
+  // Block policy: the thread events are delivered on must never wait for
+  // itself. That is the dispatcher's thread once attached, else the first
+  // thread that posted to or polled this bus. Fixed, so a poll() from some
+  // other thread cannot make the delivering thread wait forever.
+  void claimOwner()
+  {
+    if (owner_.load(std::memory_order_relaxed) != std::thread::id()) return;
+    std::thread::id none{};
+    owner_.compare_exchange_strong(none, std::this_thread::get_id(), std::memory_order_relaxed);
+  }
+
+  bool isOwnerThread() const
+  {
+    const std::thread::id dispatcher = EventDispatcher::instance().ownerThread();
+    if (dispatcher != std::thread::id()) return dispatcher == std::this_thread::get_id();
+    return owner_.load(std::memory_order_relaxed) == std::this_thread::get_id();
+  }
+
+  void push(Ev &&ev)
+  {
+    posted_.fetch_add(1, std::memory_order_relaxed);
+    const std::int64_t postedAt = eventClockNow();
+    if constexpr (KeyCoalesced<Ev>) {
+      if (coalescing_.put(std::move(ev), postedAt)) {
+        coalesced_.fetch_add(1, std::memory_order_relaxed);
+      } else {
+        noteDepth(coalescing_.size());
       }
+      return;
+    }
+    constexpr OverflowPolicy policy = overflowPolicy<Ev>();
+    if constexpr (policy == OverflowPolicy::Block) claimOwner();
+    if constexpr (policy == OverflowPolicy::Coalesce) {
+      // Once something overflowed, newer events join it so delivery order holds
+      if (hasOverflow_.load(std::memory_order_acquire)) {
+        coalesce(std::move(ev), postedAt);
+        return;
+      }
+    }
+    while (!tryPush(ev, postedAt)) {
+      if constexpr (!EventTraits<Ev>::kThreadSafe) {
+        // Single-threaded: the poster is the consumer, deliver what is queued now
+        drain(std::chrono::steady_clock::time_point::max());
+      } else if constexpr (policy == OverflowPolicy::DropNewest) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+      } else if constexpr (policy == OverflowPolicy::DropOldest) {
+        size_t first = 0;
+        if (claim(1, SIZE_MAX, first) == 1) {
+          release(first, 1);
+          dropped_.fetch_add(1, std::memory_order_relaxed);
+        }
+      } else if constexpr (policy == OverflowPolicy::Coalesce) {
+        coalesce(std::move(ev), postedAt);
+        return;
+      } else {
+        // Block: waiting on the delivering thread itself would never end
+        if (isOwnerThread()) {
+          drain(std::chrono::steady_clock::time_point::max());
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    }
+  }
 
-      new (&buffer_[writeIdx]) Ev(std::forward<Ev>(ev));
-      writeIndex_.store(nextWrite, std::memory_order_release);
-    } else {
-      // Single-threaded - just store directly
-      size_t writeIdx = writeIndex_.load(std::memory_order_relaxed);
-      size_t nextWrite = (writeIdx + 1) & (kBufferSize - 1);
-
-      if (nextWrite == readIndex_.load(std::memory_order_relaxed)) {
-        // Drain immediately for non-thread-safe events
-        drain();
-        nextWrite = (writeIndex_.load(std::memory_order_relaxed) + 1) & (kBufferSize - 1);
+  bool tryPush(Ev &ev, std::int64_t postedAt)
+  {
+    size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+    for (;;) {
+      std::atomic<size_t> &sequence = sequence_[pos & kMask];
+      const auto diff =
+        static_cast<std::ptrdiff_t>(sequence.load(std::memory_order_acquire)) - static_cast<std::ptrdiff_t>(pos);
+      if (diff == 0) {
+        if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          new (&buffer_[pos & kMask]) Ev(std::move(ev));
+          postedAt_[pos & kMask] = postedAt;
+          sequence.store(pos + 1, std::memory_order_release);
+          const size_t dequeued = dequeuePos_.load(std::memory_order_relaxed);
+          noteDepth(pos + 1 > dequeued ? pos + 1 - dequeued : 0);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;// Full: the slot still holds the event from the previous lap
+      } else {
+        pos = enqueuePos_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Takes up to `max` consecutive published events, not past position
+  // `end` nor past the end of the buffer, so they are contiguous in memory;
+  // they stay in place until release(). Returns how many, and the position
+  // of the first in `first`.
+  size_t claim(size_t max, size_t end, size_t &first)
+  {
+    size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+    for (;;) {
+      const size_t toWrap = kBufferSize - (pos & kMask);
+      const size_t limit  = max < toWrap ? max : toWrap;
+      size_t count        = 0;
+      while (count < limit && pos + count < end
+             && sequence_[(pos + count) & kMask].load(std::memory_order_acquire) == pos + count + 1) {
+        ++count;
       }
+      if (count == 0) {
+        const auto diff = static_cast<std::ptrdiff_t>(sequence_[pos & kMask].load(std::memory_order_acquire))
+                          - static_cast<std::ptrdiff_t>(pos + 1);
+        // Empty (or the next producer has not finished writing), or past `end`
+        if (diff < 0 || pos >= end) return 0;
+        pos = dequeuePos_.load(std::memory_order_relaxed);// Another consumer took it
+        continue;
+      }
+      if (dequeuePos_.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed)) {
+        first = pos;
+        return count;
+      }
+    }
+  }
 
-      new (&buffer_[writeIdx]) Ev(std::forward<Ev>(ev));
-      writeIndex_.store(nextWrite, std::memory_order_relaxed);
+  void release(size_t first, size_t count)
+  {
+    for (size_t pos = first; pos < first + count; ++pos) {
+      reinterpret_cast<Ev *>(&buffer_[pos & kMask])->~Ev();
+      sequence_[pos & kMask].store(pos + kBufferSize, std::memory_order_release);
     }
   }
 
+  void coalesce(Ev &&ev, std::int64_t postedAt)
+  {
+    std::lock_guard<std::mutex> lock(overflowMutex_);
+    if (overflow_) {
+      coalesced_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+      overflowPostedAt_ = postedAt;
+    }
+    overflow_.emplace(std::move(ev));
+    hasOverflow_.store(true, std::memory_order_release);
+  }
+
+  void noteDepth(size_t depth)
+  {
+    size_t high = highWater_.load(std::memory_order_relaxed);
+    while (depth > high && !highWater_.compare_exchange_weak(high, depth, std::memory_order_relaxed)) {}
+  }
+
   template<typename F> Handle doSubscribe(F &&f)
   {
-    std::lock_guard<std::mutex> lock(listenerMutex_);
-    size_t count = listenerCount_.load(std::memory_order_relaxed);
-    if (count >= kMaxListeners) return Handle{};
+    auto listener     = std::make_shared<Listener>();
+    listener->onEvent = std::forward<F>(f);
+    return add(std::move(listener));
+  }
 
-    listeners_[count] = std::forward<F>(f);
-    listenerCount_.store(count + 1, std::memory_order_release);
-    return Handle{ count + 1 };
+  template<typename F> Handle doSubscribeBatch(F &&f)
+  {
+    auto listener     = std::make_shared<Listener>();
+    listener->onBatch = std::forward<F>(f);
+    return add(std::move(listener));
   }
 
-  void unsubscribe(size_t id)
+  Handle add(std::shared_ptr<Listener> listener)
   {
     std::lock_guard<std::mutex> lock(listenerMutex_);
-    size_t index = id - 1;
-    if (index < listenerCount_.load(std::memory_order_relaxed)) { listeners_[index] = nullptr; }
+    std::uint32_t index = freeSlot_;
+    if (index != kNoSlot) {
+      freeSlot_ = slots_[index].nextFree;
+    } else {
+      index = static_cast<std::uint32_t>(slots_.size());
+      slots_.emplace_back();
+    }
+    Slot &slot    = slots_[index];
+    slot.listener = listener;
+    slot.nextFree = kNoSlot;
+    ++liveListeners_;
+
+    auto set = std::make_shared<ListenerSet>(*listeners_.load(std::memory_order_acquire));
+    (listener->onBatch ? set->batch : set->single).push_back(std::move(listener));
+    listeners_.store(std::move(set), std::memory_order_release);
+    return Handle{ (std::uint64_t{ slot.generation } << 32) | (std::uint64_t{ index } + 1) };
   }
 
-  void drain()
+  // O(1) apart from the occasional compaction
+  void unsubscribe(std::uint64_t id)
   {
-    size_t readIdx = readIndex_.load(std::memory_order_relaxed);
-    size_t writeIdx = writeIndex_.load(std::memory_order_acquire);
+    std::lock_guard<std::mutex> lock(listenerMutex_);
+    const auto index      = static_cast<std::uint32_t>((id & UINT32_MAX) - 1);
+    const auto generation = static_cast<std::uint32_t>(id >> 32);
+    if (index >= slots_.size() || slots_[index].generation != generation || !slots_[index].listener) return;
 
-    while (readIdx != writeIdx) {
-      Ev &event = *reinterpret_cast<Ev *>(&buffer_[readIdx]);
+    Slot &slot = slots_[index];
+    slot.listener->active.store(false, std::memory_order_release);
+    slot.listener.reset();
+    if (++slot.generation == 0) slot.generation = 1;// 0 never appears in a live handle
+    slot.nextFree = freeSlot_;
+    freeSlot_     = index;
+    --liveListeners_;
 
-      // Notify all listeners
-      size_t count = listenerCount_.load(std::memory_order_acquire);
-      for (size_t i = 0; i < count; ++i) {
-        if (listeners_[i]) { listeners_[i](event); }
+    if (++deadListeners_ <= liveListeners_) return;
+    auto set = std::make_shared<ListenerSet>();
+    const std::shared_ptr<const ListenerSet> current = listeners_.load(std::memory_order_acquire);
+    for (const auto &listener : current->single) {
+      if (listener->active.load(std::memory_order_relaxed)) set->single.push_back(listener);
+    }
+    for (const auto &listener : current->batch) {
+      if (listener->active.load(std::memory_order_relaxed)) set->batch.push_back(listener);
+    }
+    listeners_.store(std::move(set), std::memory_order_release);
+    deadListeners_ = 0;
+  }
+
+  void notify(std::span<const Ev> events, const std::int64_t *postedAt)
+  {
+    // The set (and each listener in it) stays alive until this call is done,
+    // even if a listener unsubscribes itself
+    const std::shared_ptr<const ListenerSet> set = listeners_.load(std::memory_order_acquire);
+    if (!set->single.empty()) {
+      for (const Ev &event : events) {
+        for (const auto &listener : set->single) {
+          if (listener->active.load(std::memory_order_acquire)) listener->onEvent(event);
+        }
       }
+    }
+    for (const auto &listener : set->batch) {
+      if (listener->active.load(std::memory_order_acquire)) listener->onBatch(events);
+    }
+    delivered_.fetch_add(events.size(), std::memory_order_relaxed);
+
+    const std::int64_t now = eventClockNow();
+    for (size_t i = 0; i < events.size(); ++i) latency_.record(now - postedAt[i]);
+  }
+
+  // Stops between runs once `deadline` has passed, after at least one
+  bool drain(std::chrono::steady_clock::time_point deadline)
+  {
+    if constexpr (overflowPolicy<Ev>() == OverflowPolicy::Block) claimOwner();
 
-      event.~Ev();
-      readIdx = (readIdx + 1) & (kBufferSize - 1);
+    // Only what was posted before this call: a busy producer cannot keep us here
+    const size_t end = enqueuePos_.load(std::memory_order_acquire);
+    size_t first     = 0;
+    while (size_t count = claim(kBufferSize, end, first)) {
+      notify(std::span<const Ev>(reinterpret_cast<const Ev *>(&buffer_[first & kMask]), count),
+        &postedAt_[first & kMask]);
+      release(first, count);
+      if (dequeuePos_.load(std::memory_order_relaxed) < end && std::chrono::steady_clock::now() >= deadline) {
+        return false;
+      }
     }
 
-    readIndex_.store(readIdx, std::memory_order_release);
+    if constexpr (KeyCoalesced<Ev>) {
+      // Taken out of the members so a listener that polls again gets its own
+      std::vector<Ev> batch;
+      std::vector<std::int64_t> postedAt;
+      batch.swap(coalescedBatch_);
+      postedAt.swap(coalescedPostedAt_);
+      coalescing_.take(batch, postedAt);
+      if (!batch.empty()) notify(batch, postedAt.data());
+      batch.clear();
+      coalescedBatch_.swap(batch);
+      coalescedPostedAt_.swap(postedAt);
+    } else if constexpr (overflowPolicy<Ev>() == OverflowPolicy::Coalesce) {
+      if (!hasOverflow_.load(std::memory_order_acquire)) return true;
+      std::optional<Ev> event;
+      std::int64_t postedAt = 0;
+      {
+        std::lock_guard<std::mutex> lock(overflowMutex_);
+        event.swap(overflow_);
+        postedAt = overflowPostedAt_;
+        hasOverflow_.store(false, std::memory_order_release);
+      }
+      if (event) notify(std::span<const Ev>(&*event, 1), &postedAt);
+    }
+    return true;
   }
 };
 
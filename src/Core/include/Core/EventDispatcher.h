@@ -0,0 +1,159 @@
+// include/Core/EventDispatcher.h
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class QObject;
+class QSocketNotifier;
+
+namespace CodeWizard::Core {
+
+// Counters of one EventBus; a snapshot, each value read on its own
+struct EventBusStats
+{
+  std::uint64_t posted    = 0;
+  std::uint64_t delivered = 0;
+  std::uint64_t dropped   = 0;// Lost to DropOldest / DropNewest
+  std::uint64_t coalesced = 0;// Replaced by a newer event under Coalesce
+  std::size_t highWater   = 0;// Most events queued at once
+};
+
+// Timestamps events carry from post() to delivery
+inline std::int64_t eventClockNow() noexcept
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+    .count();
+}
+
+// Post-to-delivery latency, in power-of-two buckets of microseconds:
+// bucket 0 is below 1 us, bucket i covers [2^(i-1), 2^i) us, the last one
+// everything from about 4 s up. Recording is one relaxed increment.
+class LatencyHistogram
+{
+public:
+  static constexpr std::size_t kBuckets = 24;
+
+  void record(std::int64_t nanoseconds) noexcept
+  {
+    const auto micros = static_cast<std::uint64_t>(nanoseconds > 0 ? nanoseconds / 1000 : 0);
+    // bit_width() returns int since LWG 3656 and the argument type before it
+    const auto i = static_cast<unsigned>(std::bit_width(micros));
+    counts_[i < kBuckets ? i : kBuckets - 1].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] std::uint64_t count() const noexcept
+  {
+    std::uint64_t total = 0;
+    for (const auto &bucket : counts_) total += bucket.load(std::memory_order_relaxed);
+    return total;
+  }
+
+  [[nodiscard]] std::uint64_t bucket(std::size_t i) const noexcept { return counts_[i].load(std::memory_order_relaxed); }
+
+  // Upper bound of the bucket holding the q-th quantile (0..1); zero when empty
+  [[nodiscard]] std::chrono::microseconds percentile(double q) const noexcept
+  {
+    const std::uint64_t total = count();
+    if (total == 0) return std::chrono::microseconds(0);
+    const auto rank    = static_cast<std::uint64_t>(q * static_cast<double>(total - 1)) + 1;
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < kBuckets; ++i) {
+      seen += bucket(i);
+      if (seen >= rank) return std::chrono::microseconds(std::int64_t{ 1 } << i);
+    }
+    return std::chrono::microseconds(std::int64_t{ 1 } << (kBuckets - 1));
+  }
+
+  void reset() noexcept
+  {
+    for (auto &bucket : counts_) bucket.store(0, std::memory_order_relaxed);
+  }
+
+private:
+  std::array<std::atomic<std::uint64_t>, kBuckets> counts_{};
+};
+
+// What the dispatcher sees of an EventBus<Ev>
+class EventQueue
+{
+public:
+  virtual ~EventQueue() = default;
+
+  // Delivers pending events; stops early, between runs, once `deadline`
+  // has passed. Returns true if nothing posted before the call is left.
+  virtual bool pump(std::chrono::steady_clock::time_point deadline) = 0;
+  [[nodiscard]] virtual bool hasPending() const = 0;
+
+  [[nodiscard]] virtual const char *queueName() const = 0;
+  [[nodiscard]] virtual EventBusStats queueStats() const = 0;
+  [[nodiscard]] virtual const LatencyHistogram &queueLatency() const = 0;
+};
+
+// Drains every EventBus from the UI thread's event loop. Buses register
+// themselves on first use; post() wakes the dispatcher through an eventfd
+// watched by a QSocketNotifier (a queued call where there is no eventfd),
+// only when no pump is pending already. A pump spends at most the frame
+// budget, then yields to input and painting and continues on the next pass.
+class EventDispatcher
+{
+public:
+  static EventDispatcher &instance();
+
+  // Start pumping from the calling thread's event loop; call once the
+  // QApplication exists
+  void attach();
+  void detach();
+  [[nodiscard]] bool isAttached() const noexcept { return attached_.load(std::memory_order_acquire); }
+  // The thread attach() was called on; a default id while detached
+  [[nodiscard]] std::thread::id ownerThread() const noexcept { return ownerThread_.load(std::memory_order_acquire); }
+
+  // Called by every post(): a relaxed exchange unless a wakeup is needed
+  static void wake() noexcept { instance().requestPump(); }
+
+  // Drains all buses within the budget (at least one run each time it is
+  // called, if anything is pending); true if everything was delivered
+  bool pump() { return pump(frameBudget_); }
+  bool pump(std::chrono::microseconds budget);
+
+  void setFrameBudget(std::chrono::microseconds budget) { frameBudget_ = budget; }
+  [[nodiscard]] std::chrono::microseconds frameBudget() const { return frameBudget_; }
+
+  void add(EventQueue *queue);
+  void remove(EventQueue *queue);
+  void forEachQueue(const std::function<void(const EventQueue &)> &f) const;
+
+  // One log line per event type: counters and latency percentiles
+  void logStats() const;
+
+private:
+  EventDispatcher() = default;
+  ~EventDispatcher();
+
+  void requestPump() noexcept;
+  void signal() noexcept;
+
+  mutable std::mutex mutex_;// Guards queues_
+  std::vector<EventQueue *> queues_;
+  std::vector<EventQueue *> pumping_;// Copy pump() iterates, so listeners may register buses
+  std::size_t next_ = 0;             // Round-robin start: a busy bus cannot starve the others
+  bool inPump_      = false;
+
+  std::chrono::microseconds frameBudget_{ 4000 };
+  std::atomic<bool> attached_{ false };
+  std::atomic<std::thread::id> ownerThread_{};
+  alignas(64) std::atomic<bool> pending_{ false };
+  int eventFd_ = -1;
+  std::unique_ptr<QSocketNotifier> notifier_;
+  std::unique_ptr<QObject> context_;// Target of the queued-call fallback
+};
+
+}// namespace CodeWizard::Core
@@ -0,0 +1,149 @@
+// src/EventDispatcher.cpp
+#include "Core/EventDispatcher.h"
+#include "Core/Logger.h"
+#include <QObject>
+#include <QSocketNotifier>
+#include <algorithm>
+#include <string>
+
+#ifdef __linux__
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+namespace CodeWizard::Core {
+
+EventDispatcher &EventDispatcher::instance()
+{
+  static EventDispatcher dispatcher;
+  return dispatcher;
+}
+
+EventDispatcher::~EventDispatcher() { detach(); }
+
+void EventDispatcher::attach()
+{
+  if (attached_.load(std::memory_order_acquire)) return;
+  context_ = std::make_unique<QObject>();
+#ifdef __linux__
+  eventFd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (eventFd_ >= 0) {
+    notifier_ = std::make_unique<QSocketNotifier>(static_cast<qintptr>(eventFd_), QSocketNotifier::Read);
+    QObject::connect(notifier_.get(), &QSocketNotifier::activated, context_.get(), [this]() { pump(); });
+  }
+#endif
+  ownerThread_.store(std::this_thread::get_id(), std::memory_order_release);
+  attached_.store(true, std::memory_order_release);
+
+  // Deliver whatever was posted before the event loop existed
+  pending_.store(false, std::memory_order_release);
+  requestPump();
+}
+
+void EventDispatcher::detach()
+{
+  if (!attached_.exchange(false, std::memory_order_acq_rel)) return;
+  ownerThread_.store(std::thread::id(), std::memory_order_release);
+  notifier_.reset();
+  context_.reset();
+#ifdef __linux__
+  if (eventFd_ >= 0) ::close(eventFd_);
+#endif
+  eventFd_ = -1;
+}
+
+void EventDispatcher::requestPump() noexcept
+{
+  // Only the first post after a pump pays for the wakeup
+  if (pending_.load(std::memory_order_relaxed) || pending_.exchange(true, std::memory_order_acq_rel)) return;
+  if (attached_.load(std::memory_order_acquire)) signal();
+}
+
+void EventDispatcher::signal() noexcept
+{
+#ifdef __linux__
+  if (eventFd_ >= 0) {
+    const std::uint64_t one = 1;
+    [[maybe_unused]] const ssize_t written = ::write(eventFd_, &one, sizeof(one));
+    return;
+  }
+#endif
+  QMetaObject::invokeMethod(context_.get(), [this]() { pump(); }, Qt::QueuedConnection);
+}
+
+bool EventDispatcher::pump(std::chrono::microseconds budget)
+{
+  if (inPump_) return false;// A listener spinning a nested event loop
+  inPump_ = true;
+
+  // Posts from here on need a new wakeup
+  pending_.store(false, std::memory_order_release);
+#ifdef __linux__
+  if (eventFd_ >= 0) {
+    std::uint64_t count = 0;
+    [[maybe_unused]] const ssize_t read = ::read(eventFd_, &count, sizeof(count));
+  }
+#endif
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pumping_ = queues_;
+  }
+  const auto deadline = std::chrono::steady_clock::now() + budget;
+  const std::size_t n = pumping_.size();
+  bool done           = true;
+  std::size_t i       = 0;
+  bool worked         = false;
+  for (; i < n; ++i) {
+    EventQueue *queue = pumping_[(next_ + i) % n];
+    if (!queue->hasPending()) continue;
+    if (worked && std::chrono::steady_clock::now() >= deadline) {
+      done = false;
+      break;
+    }
+    worked = true;
+    if (!queue->pump(deadline)) {
+      done = false;
+      break;
+    }
+  }
+  // The next pump starts with the bus this one could not finish
+  if (n > 0) next_ = (next_ + i) % n;
+  inPump_ = false;
+
+  if (!done) requestPump();
+  return done;
+}
+
+void EventDispatcher::add(EventQueue *queue)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  queues_.push_back(queue);
+}
+
+void EventDispatcher::remove(EventQueue *queue)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  queues_.erase(std::remove(queues_.begin(), queues_.end(), queue), queues_.end());
+}
+
+void EventDispatcher::forEachQueue(const std::function<void(const EventQueue &)> &f) const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const EventQueue *queue : queues_) f(*queue);
+}
+
+void EventDispatcher::logStats() const
+{
+  forEachQueue([](const EventQueue &queue) {
+    const EventBusStats stats       = queue.queueStats();
+    const LatencyHistogram &latency = queue.queueLatency();
+    CW_LOG_INFO(std::string("EventBus ") + queue.queueName() + ": " + std::to_string(stats.posted) + " posted, "
+                + std::to_string(stats.delivered) + " delivered, " + std::to_string(stats.dropped) + " dropped, "
+                + std::to_string(stats.coalesced) + " coalesced, high water " + std::to_string(stats.highWater)
+                + ", latency p50 < " + std::to_string(latency.percentile(0.5).count()) + " us, p99 < "
+                + std::to_string(latency.percentile(0.99).count()) + " us");
+  });
+}
+
+}// namespace CodeWizard::Core
@@ -45,38 +45,7 @@ void ThreadPool::workerLoop() {
     }
 }
 
-template<typename F, typename... Args>
-auto ThreadPool::submit(F&& f, Args&&... args)
-    -> std::future<std::invoke_result_t<std::decay_t<F>, std::decay_t<Args>...>> {
-
-    using ReturnType = std::invoke_result_t<std::decay_t<F>, std::decay_t<Args>...>;
-    auto task = std::make_shared<std::packaged_task<ReturnType()>>(
-        std::bind(std::forward<F>(f), std::forward<Args>(args)...)
-    );
-
-    std::future<ReturnType> result = task->get_future();
-    {
-        std::lock_guard<std::mutex> lock(m_queueMutex);
-        if (!m_stop) {
-            m_tasks.emplace([task]() { (*task)(); });
-        }
-    }
-    m_condition.notify_one();
-    return result;
-}
-
-template<typename F>
-void ThreadPool::post(F&& f) {
-    {
-        std::lock_guard<std::mutex> lock(m_queueMutex);
-        if (!m_stop) {
-            m_tasks.emplace(std::forward<F>(f));
-        }
-    }
-    m_condition.notify_one();
-}
-
-ThreadPool& globalThreadPool() {
+ThreadPool& CodeWizard::Core::globalThreadPool() {
     static ThreadPool pool;
     return pool;
 }
\ No newline at end of file
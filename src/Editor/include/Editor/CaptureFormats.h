@@ -0,0 +1,56 @@
+#pragma once
+#include <QTextCharFormat>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <tree_sitter/api.h>
+
+namespace CodeWizard::Editor {
+
+// Capture name ("function.call") -> format
+using HighlightTheme = std::unordered_map<std::string, QTextCharFormat>;
+
+// Formats of one highlight query under one theme, indexed by capture id
+struct CaptureFormatTable
+{
+  std::shared_ptr<const HighlightTheme> theme;// Owns the formats pointed to
+  std::vector<const QTextCharFormat *> formats;// nullptr = unstyled
+
+  [[nodiscard]] const QTextCharFormat *at(uint32_t captureIndex) const
+  {
+    return captureIndex < formats.size() ? formats[captureIndex] : nullptr;
+  }
+};
+
+/*--------------------------------------------------------------------
+ *  CaptureFormats  –  capture id -> format tables, shared by documents
+ *
+ *  Themes are interned: equal themes give the same pointer, so every
+ *  document with the same language and theme gets the same table.
+ *  A table resolves each capture name once, falling back to parent
+ *  names ("function.method.call" -> "function.method" -> "function").
+ *  Tables are kept only while a document uses them.
+ *  Keyed by TSQuery: queries live as long as their LanguageInfo, which
+ *  TreeSitterManager keeps for the whole session. UI thread only.
+ *------------------------------------------------------------------*/
+class CaptureFormats
+{
+public:
+  static CaptureFormats &instance();
+
+  [[nodiscard]] std::shared_ptr<const HighlightTheme> intern(const HighlightTheme &theme);
+  [[nodiscard]] std::shared_ptr<const CaptureFormatTable> table(const TSQuery *query,
+    const std::shared_ptr<const HighlightTheme> &theme);
+
+private:
+  CaptureFormats() = default;
+
+  std::vector<std::weak_ptr<const HighlightTheme>> m_themes;
+  std::map<std::pair<const TSQuery *, const HighlightTheme *>, std::weak_ptr<const CaptureFormatTable>> m_tables;
+};
+
+}// namespace CodeWizard::Editor
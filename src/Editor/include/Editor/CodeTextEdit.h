@@ -32,14 +32,19 @@ struct SelectionEvent
 template<> struct CodeWizard::Core::EventTraits<IncChangeEvent>
 {
   static constexpr bool kThreadSafe = true;
+  static constexpr OverflowPolicy kOverflow = OverflowPolicy::Block;// A lost edit desynchronizes listeners
 };
+// Only the latest cursor / selection per file matters: a held arrow key or
+// a drag delivers one event per file and poll, not one per move
 template<> struct CodeWizard::Core::EventTraits<CursorMovedEvent>
 {
   static constexpr bool kThreadSafe = true;
+  static const QString &coalesceKey(const CursorMovedEvent &ev) { return ev.file; }
 };
 template<> struct CodeWizard::Core::EventTraits<SelectionEvent>
 {
   static constexpr bool kThreadSafe = true;
+  static const QString &coalesceKey(const SelectionEvent &ev) { return ev.file; }
 };
 namespace CodeWizard::Editor {
 /*--------------------------------------------------------------------
@@ -55,6 +60,7 @@ public:
   void setFileName(const QString &name)
   {
     m_file = name;    // Auto-detect language from file extension
+    document()->setMetaInformation(QTextDocument::DocumentUrl, name);
     std::string ext = CodeWizard::Platform::Path(name.toStdString()).extension().substr(1);
     if (ext == "cpp" || ext == "cc" || ext == "cxx") {
       setLanguage("cpp");
@@ -83,6 +89,9 @@ public:
     m_version = 1;
   }
   QString documentText() const { return QPlainTextEdit::toPlainText(); }
+  // UTF-8 copy of the text that another thread may read: O(1) while the
+  // highlighter mirrors the document, one conversion otherwise
+  [[nodiscard]] TextBuffer snapshot() const;
 
   // ---- zoom ----
   void wheelEvent(QWheelEvent *e) override;
@@ -98,21 +107,31 @@ public:
   void keyPressEvent(QKeyEvent *e) override;
   void indentBlock(bool unIndent);
   void lineNumberAreaPaintEvent(QPaintEvent *event);
+  void lineNumberAreaMousePressEvent(QMouseEvent *event);
   int lineNumberAreaWidth();
+
+  // ---- folding ----
+  // Collapse or expand the fold region whose header is `line`
+  void toggleFold(int line);
   void setLanguage(const std::string& languageId);
 protected:
   void resizeEvent(QResizeEvent *e) override;
   void paintEvent(QPaintEvent *e) override;
+  void focusInEvent(QFocusEvent *e) override;
 
 private slots:
   void onContentsChange(int pos, int charsRemoved, int charsAdded);
   void onCursor();
   void onSelection();
+  void onFoldsChanged();
 
 private:
   void updateLineNumberAreaWidth();
   void updateLineNumberArea(const QRect &rect, int dy);
+  void updateHighlightWindow();
   void applyTheme();
+  int foldMarkerWidth() const;
+  void setLinesVisible(int first, int last, bool visible);
 
   QWidget *m_lineNumberArea = nullptr;
   QString m_file;
@@ -130,6 +149,7 @@ public:
 
 protected:
   void paintEvent(QPaintEvent *event) override { m_codeEditor->lineNumberAreaPaintEvent(event); }
+  void mousePressEvent(QMouseEvent *event) override { m_codeEditor->lineNumberAreaMousePressEvent(event); }
 
 private:
   CodeTextEdit *m_codeEditor;
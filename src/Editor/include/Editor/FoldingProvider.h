@@ -0,0 +1,67 @@
+#pragma once
+#include "Editor/TextBuffer.h"
+#include "Editor/TreeSitterManager.h"
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace CodeWizard::Editor {
+
+// A node of folds.scm spanning several lines. When collapsed, lines
+// firstHiddenLine() .. lastHiddenLine() are hidden; the header line stays.
+struct FoldRegion
+{
+  TSRange range{};
+  bool keepLastLine = false;// The last line is only the closing bracket: leave it visible
+  bool collapsed    = false;
+
+  [[nodiscard]] uint32_t headerLine() const { return range.start_point.row; }
+  [[nodiscard]] uint32_t firstHiddenLine() const { return range.start_point.row + 1; }
+  [[nodiscard]] uint32_t lastHiddenLine() const { return range.end_point.row - (keepLastLine ? 1 : 0); }
+};
+
+using FoldRegions = std::vector<FoldRegion>;// Sorted by start byte
+
+// Folds of `tree` after a parse (runs in the parse job). Regions of
+// `previous` that intersect no `changed` byte range are kept as they are;
+// the folds query only runs over the changed ranges. `full` rescans everything.
+[[nodiscard]] FoldRegions findFolds(const LanguageInfo &language,
+  const TSTree *tree,
+  const TextBuffer &text,
+  FoldRegions previous,
+  const std::vector<std::pair<size_t, size_t>> &changed,
+  bool full);
+
+/*--------------------------------------------------------------------
+ *  FoldingProvider  –  fold regions of one document (UI thread)
+ *
+ *  Regions are moved with every edit like the syntax tree, replaced
+ *  by the result of findFolds() after each parse, and keep their
+ *  collapsed state across parses as long as their start is unchanged.
+ *  Collapsed regions that disappear are reported through
+ *  takeReleased() so the view can show their lines again.
+ *------------------------------------------------------------------*/
+class FoldingProvider
+{
+public:
+  void clear();
+  void edit(const TSInputEdit &edit);
+  void adopt(FoldRegions regions);
+
+  [[nodiscard]] const FoldRegions &regions() const { return m_regions; }
+
+  // Outermost region whose header is `line`, if any
+  [[nodiscard]] FoldRegion *regionAt(uint32_t line);
+  [[nodiscard]] const FoldRegion *regionAt(uint32_t line) const;
+  // Outermost collapsed region whose header is `line`, if any
+  [[nodiscard]] const FoldRegion *collapsedAt(uint32_t line) const;
+
+  // Lines (first, last) of collapsed regions lost by the last adopt()
+  [[nodiscard]] std::vector<std::pair<uint32_t, uint32_t>> takeReleased() { return std::exchange(m_released, {}); }
+
+private:
+  FoldRegions m_regions;
+  std::vector<std::pair<uint32_t, uint32_t>> m_released;
+};
+
+}// namespace CodeWizard::Editor
@@ -0,0 +1,67 @@
+#pragma once
+#include <QString>
+#include <QtGlobal>
+#include <cstddef>
+#include <vector>
+
+namespace CodeWizard::Editor {
+
+class TreeSitterHighlighter;
+
+struct DocumentMemory
+{
+  QString document;// DocumentUrl meta information of the QTextDocument
+  size_t bytes   = 0;
+  bool suspended = false;
+};
+
+/*--------------------------------------------------------------------
+ *  HighlightBudget  –  caps the memory of all highlighters together
+ *
+ *  Every TreeSitterHighlighter registers itself. When the sum of
+ *  their text buffers, syntax trees and span tables exceeds the
+ *  budget, the least recently focused documents are suspended: they
+ *  keep the formats already on screen but drop everything else.
+ *  Focusing a suspended document rebuilds its state (one full parse).
+ *
+ *  Budget in MiB from Core::Config "editor.highlightMemoryBudgetMB",
+ *  read on every check; 0 disables eviction. UI thread only.
+ *------------------------------------------------------------------*/
+class HighlightBudget
+{
+public:
+  static constexpr const char *kConfigKey = "editor.highlightMemoryBudgetMB";
+  static constexpr int kDefaultBudgetMB   = 256;
+
+  static HighlightBudget &instance();
+
+  void add(TreeSitterHighlighter *highlighter);
+  void remove(TreeSitterHighlighter *highlighter);
+
+  // The document got focus: bring it back if it was suspended, then make room for it
+  void touch(TreeSitterHighlighter *highlighter);
+  // Suspend least recently focused documents until the total fits the budget
+  void enforce();
+
+  [[nodiscard]] size_t budgetBytes() const;
+  [[nodiscard]] size_t totalBytes() const;
+  [[nodiscard]] int evictions() const { return m_evictions; }
+
+  // One entry per document, most recently focused first
+  [[nodiscard]] std::vector<DocumentMemory> report() const;
+
+private:
+  HighlightBudget() = default;
+
+  struct Entry
+  {
+    TreeSitterHighlighter *highlighter = nullptr;
+    quint64 lastFocus                  = 0;
+  };
+
+  std::vector<Entry> m_entries;
+  quint64 m_focusClock = 0;
+  int m_evictions      = 0;
+};
+
+}// namespace CodeWizard::Editor
@@ -0,0 +1,25 @@
+#pragma once
+#include <QLoggingCategory>
+
+// Highlighter tracing has two gates:
+//  - compile time: CODEWIZARD_HIGHLIGHT_TRACE_LEVEL (CMake cache variable of
+//    the same name). 0 compiles every trace out, 1 keeps language and edit
+//    events, 2 adds per-block captures.
+//  - run time: the "codewizard.editor.highlighter" category, off by default.
+//    Enable with QT_LOGGING_RULES="codewizard.editor.highlighter.debug=true".
+// Arguments of a disabled trace are never evaluated.
+#ifndef CODEWIZARD_HIGHLIGHT_TRACE_LEVEL
+#define CODEWIZARD_HIGHLIGHT_TRACE_LEVEL 0
+#endif
+
+namespace CodeWizard::Editor {
+Q_DECLARE_LOGGING_CATEGORY(lcHighlighter)
+}// namespace CodeWizard::Editor
+
+#define CW_HIGHLIGHT_TRACE_ENABLED(level) \
+  ((level) <= CODEWIZARD_HIGHLIGHT_TRACE_LEVEL && ::CodeWizard::Editor::lcHighlighter().isDebugEnabled())
+
+#define CW_HIGHLIGHT_TRACE(level)                        \
+  if (!((level) <= CODEWIZARD_HIGHLIGHT_TRACE_LEVEL)) {  \
+  } else                                                 \
+    qCDebug(::CodeWizard::Editor::lcHighlighter)
@@ -0,0 +1,64 @@
+#pragma once
+#include "Editor/TextBuffer.h"
+#include "Editor/TreeSitterManager.h"
+#include <QStringList>
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace CodeWizard::Editor {
+
+// One embedded region (a code fence, a regex literal, a macro body...)
+// parsed with its own language, restricted to the region's byte range
+struct InjectionLayer
+{
+  std::shared_ptr<LanguageInfo> language;
+  TSRange range{};
+  std::shared_ptr<TSTree> tree;
+  bool reparsed = false;// Parsed by the last update (its blocks need re-formatting)
+};
+
+using InjectionLayers = std::vector<InjectionLayer>;
+
+// Move a range of the old text to where the edit puts it. Positions inside
+// the replaced text collapse to its start (range start) or new end (range end).
+void editRange(TSRange &range, const TSInputEdit &edit);
+
+// Keep layers in step with an edit of the host text (UI thread, per keystroke):
+// trees are edited like the host tree and ranges move with the text
+void editInjectionLayers(InjectionLayers &layers, const TSInputEdit &edit);
+
+/*--------------------------------------------------------------------
+ *  InjectionEngine  –  finds and parses injected languages
+ *
+ *  Runs inside the parse job, after the host tree was parsed. Only
+ *  the host ranges that changed are searched with the host's
+ *  injections.scm; layers outside them keep their tree untouched.
+ *  Layers inside are reparsed with ts_parser_set_included_ranges,
+ *  incrementally when a layer of the same language was there before.
+ *  Parsers and the query cursor are borrowed from ParserPool.
+ *  One level deep: injected layers do not inject further.
+ *------------------------------------------------------------------*/
+class InjectionEngine
+{
+public:
+  // The cancellation flag is shared with the host parser; it is written
+  // through std::atomic_ref and handed to tree-sitter as is
+  explicit InjectionEngine(size_t &cancelFlag) : m_cancelFlag(cancelFlag) {}
+
+  // `changed` are byte ranges of the new text; `full` rescans everything.
+  // Languages whose queries are still compiling are skipped and reported in `pending`.
+  InjectionLayers update(const LanguageInfo &host,
+    const TSTree *hostTree,
+    const TextBuffer &text,
+    InjectionLayers previous,
+    std::vector<std::pair<size_t, size_t>> changed,
+    bool full,
+    QStringList &pending);
+
+private:
+  size_t &m_cancelFlag;
+};
+
+}// namespace CodeWizard::Editor
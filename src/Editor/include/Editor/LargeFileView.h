@@ -0,0 +1,64 @@
+#pragma once
+#include "Editor/LineIndex.h"
+#include "Platform/MappedFile.h"
+#include <QAbstractScrollArea>
+#include <QStringConverter>
+#include <QTimer>
+
+namespace CodeWizard::Editor {
+/*--------------------------------------------------------------------
+ *  LargeFileView  –  read-only viewer over a memory-mapped file
+ *
+ *  For files too large for QTextDocument. Nothing is read or decoded
+ *  up front: each paint decodes just the visible lines straight from
+ *  the mapping. The line index is built by short idle-time slices;
+ *  pages it has scanned are dropped again so resident memory stays
+ *  around what is on screen, whatever the file size. Nothing scans
+ *  the file synchronously: lines past the index are shown at their
+ *  estimated position until the slices reach them.
+ *------------------------------------------------------------------*/
+class LargeFileView : public QAbstractScrollArea
+{
+  Q_OBJECT
+public:
+  // `encoding` and the BOM length come from the file loader; visible lines are decoded with them
+  LargeFileView(Platform::MappedFile file,
+    QStringConverter::Encoding encoding,
+    size_t bomLength,
+    QWidget *parent = nullptr);
+
+  [[nodiscard]] size_t fileSize() const { return m_file.size(); }
+  [[nodiscard]] bool isIndexed() const { return m_index.isComplete(); }
+  [[nodiscard]] size_t lineCount() const { return m_index.lineCount(); }
+
+  // Scrolls `line` to the top; SIZE_MAX for the end of the file
+  void gotoLine(size_t line);
+
+signals:
+  void indexingFinished(qint64 lineCount);
+
+protected:
+  void paintEvent(QPaintEvent *event) override;
+  void resizeEvent(QResizeEvent *event) override;
+  void keyPressEvent(QKeyEvent *event) override;
+
+private slots:
+  void indexSlice();
+
+private:
+  void applyTheme();
+  void updateScrollRanges();
+  void followTarget();
+  [[nodiscard]] int gutterWidth() const;
+  [[nodiscard]] int visibleLineCount() const;
+
+  Platform::MappedFile m_file;
+  QStringConverter::Encoding m_encoding;
+  size_t m_bomLength;
+  LineIndex m_index;
+  QTimer *m_indexTimer;
+  int m_widestLine   = 0;// Widest line painted so far, in pixels (sets the horizontal range)
+  size_t m_targetLine = 0;// Line of the last gotoLine(), kept in view while m_following
+  bool m_following    = false;
+};
+}// namespace CodeWizard::Editor
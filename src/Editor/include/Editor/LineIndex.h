@@ -0,0 +1,77 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace CodeWizard::Editor {
+
+/*--------------------------------------------------------------------
+ *  LineIndex  –  line lookups over read-only text, built lazily (no Qt)
+ *
+ *  Scans the text front to back with memchr, only as far as
+ *  buildSome() is allowed to go, so a view can open a mapped
+ *  multi-gigabyte file at once and finish indexing in idle time.
+ *  Lookups never scan ahead: lines past the indexed prefix are only
+ *  located approximately, through estimatedLineStart().
+ *  Only every kStride-th line start is stored (8 bytes per kStride
+ *  lines); lookups scan forward from the nearest checkpoint.
+ *  Until the scan reaches the end, lineCount() is an estimate from
+ *  the average line length seen so far. UTF-16 text is indexed by its
+ *  two-byte line feeds; offsets stay in bytes.
+ *------------------------------------------------------------------*/
+class LineIndex
+{
+public:
+  static constexpr size_t kStride = 64;
+
+  // How a line feed is spelled: one byte (UTF-8, Latin-1) or one UTF-16 code unit
+  enum class CodeUnit { Byte, Utf16LE, Utf16BE };
+
+  // `text` starts after any byte order mark
+  explicit LineIndex(std::string_view text = {}, CodeUnit unit = CodeUnit::Byte);
+
+  // Index up to `maxBytes` more bytes; returns true once the whole text is indexed
+  bool buildSome(size_t maxBytes);
+  [[nodiscard]] bool isComplete() const { return m_scanned == m_text.size(); }
+  [[nodiscard]] size_t indexedBytes() const { return m_scanned; }
+
+  // Exact once complete (a final line feed starts an empty last line)
+  [[nodiscard]] size_t lineCount() const;
+
+  // True once the scan has passed the start of `line`
+  [[nodiscard]] bool isLineIndexed(size_t line) const { return line <= m_lineFeeds; }
+  // Byte offset where `line` starts; npos if it is not indexed (yet) or past the last line
+  [[nodiscard]] size_t lineStart(size_t line) const;
+  // Exact for indexed lines; otherwise the start of the line where `line`
+  // would be at the average line length seen so far
+  [[nodiscard]] size_t estimatedLineStart(size_t line) const;
+  // Text of the line starting at `start`, without its line break. With a
+  // limit, at most `maxBytes` of it: the rest continues at nextLineStart()
+  [[nodiscard]] std::string_view lineAt(size_t start, size_t maxBytes = npos) const;
+  // Offset of the line after the one starting at `start`; npos on the last line.
+  // Never reads more than `maxBytes` ahead: a longer line is cut there, and the
+  // offset returned is where its rest starts (isLineStart() is false there)
+  [[nodiscard]] size_t nextLineStart(size_t start, size_t maxBytes = npos) const;
+  // True if a line starts at `offset` (it follows a line feed, or is 0)
+  [[nodiscard]] bool isLineStart(size_t offset) const;
+
+  // Heap used by the checkpoints
+  [[nodiscard]] size_t memoryUsage() const { return m_checkpoints.capacity() * sizeof(uint64_t); }
+
+  static constexpr size_t npos = static_cast<size_t>(-1);
+
+private:
+  [[nodiscard]] size_t unitSize() const { return m_unit == CodeUnit::Byte ? 1 : 2; }
+  [[nodiscard]] bool isLineFeedAt(size_t pos) const;
+  // Offset of the first line feed in [from, end), npos if there is none
+  [[nodiscard]] size_t findLineFeed(size_t from, size_t end) const;
+
+  std::string_view m_text;
+  CodeUnit m_unit = CodeUnit::Byte;
+  std::vector<uint64_t> m_checkpoints;// Start of lines 0, kStride, 2 * kStride, ...
+  size_t m_lineFeeds = 0;             // Line feeds in [0, m_scanned)
+  size_t m_scanned   = 0;
+};
+
+}// namespace CodeWizard::Editor
@@ -0,0 +1,116 @@
+#pragma once
+#include <cstddef>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <tree_sitter/api.h>
+
+namespace CodeWizard::Editor {
+
+class ParserPool;
+
+// Move-only loan of a pooled object; goes back to the pool when destroyed
+template<typename T> class PoolLease
+{
+public:
+  PoolLease() = default;
+  PoolLease(ParserPool *pool, T *object, const void *key) : m_pool(pool), m_object(object), m_key(key) {}
+  ~PoolLease() { release(); }
+  PoolLease(PoolLease &&other) noexcept
+    : m_pool(std::exchange(other.m_pool, nullptr)), m_object(std::exchange(other.m_object, nullptr)), m_key(other.m_key)
+  {}
+  PoolLease &operator=(PoolLease &&other) noexcept
+  {
+    if (this != &other) {
+      release();
+      m_pool   = std::exchange(other.m_pool, nullptr);
+      m_object = std::exchange(other.m_object, nullptr);
+      m_key    = other.m_key;
+    }
+    return *this;
+  }
+  PoolLease(const PoolLease &)            = delete;
+  PoolLease &operator=(const PoolLease &) = delete;
+
+  [[nodiscard]] T *get() const { return m_object; }
+  explicit operator bool() const { return m_object != nullptr; }
+
+  void release();
+
+private:
+  ParserPool *m_pool = nullptr;
+  T *m_object        = nullptr;
+  const void *m_key  = nullptr;// Language of a parser, unused for cursors
+};
+
+using ParserLease = PoolLease<TSParser>;
+using CursorLease = PoolLease<TSQueryCursor>;
+
+struct ParserPoolStatistics
+{
+  size_t parsersInUse = 0;
+  size_t parsersIdle  = 0;
+  size_t cursorsInUse = 0;
+  size_t cursorsIdle  = 0;
+  size_t languages    = 0;// Languages with at least one live parser
+};
+
+/*--------------------------------------------------------------------
+ *  ParserPool  –  TSParser / TSQueryCursor shared by all documents
+ *
+ *  Parsers are kept per language; a document borrows one for the
+ *  duration of a parse job and hands it back, so documents that are
+ *  not being edited hold nothing but their TSTree. Query cursors are
+ *  language independent and borrowed per highlight sweep.
+ *  Returned objects are reset (cancellation flag, timeout, included
+ *  ranges) and only a few idle ones are kept per language.
+ *  Thread-safe: parse jobs borrow from the thread pool.
+ *------------------------------------------------------------------*/
+class ParserPool
+{
+public:
+  static ParserPool &instance();
+  ~ParserPool();
+
+  // Empty lease if the grammar's ABI is not supported by the linked tree-sitter
+  [[nodiscard]] ParserLease acquireParser(const TSLanguage *language);
+  [[nodiscard]] CursorLease acquireCursor();
+
+  [[nodiscard]] ParserPoolStatistics statistics() const;
+
+  // Idle objects kept around; the rest are deleted when returned
+  void setMaxIdle(size_t parsersPerLanguage, size_t cursors);
+
+  // Delete every idle object (e.g. when the last editor closes)
+  void trim();
+
+private:
+  template<typename T> friend class PoolLease;
+  ParserPool() = default;
+
+  void release(TSParser *parser, const void *language);
+  void release(TSQueryCursor *cursor, const void *);
+
+  struct LanguageParsers
+  {
+    std::vector<TSParser *> idle;
+    size_t inUse = 0;
+  };
+
+  mutable std::mutex m_mutex;
+  std::unordered_map<const TSLanguage *, LanguageParsers> m_parsers;
+  std::vector<TSQueryCursor *> m_idleCursors;
+  size_t m_cursorsInUse   = 0;
+  size_t m_maxIdleParsers = 2;
+  size_t m_maxIdleCursors = 4;
+};
+
+template<typename T> void PoolLease<T>::release()
+{
+  if (m_pool && m_object) m_pool->release(m_object, m_key);
+  m_pool   = nullptr;
+  m_object = nullptr;
+}
+
+}// namespace CodeWizard::Editor
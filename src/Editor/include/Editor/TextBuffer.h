@@ -0,0 +1,97 @@
+#pragma once
+
+#include <Core/Types.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace CodeWizard::Editor {
+namespace detail {
+  struct PieceChunk;
+  struct PieceNode;
+}// namespace detail
+
+/*--------------------------------------------------------------------
+ *  TextBuffer  –  UTF-8 piece table (no Qt)
+ *
+ *  Pieces are kept in a persistent treap ordered by document offset.
+ *  Every node caches the byte length, line-feed count and UTF-16
+ *  length of its subtree, so edits, line/offset lookups and
+ *  UTF-8 <-> UTF-16 conversions cost O(log n) instead of rescanning
+ *  the text. Nodes are immutable and shared: copying a
+ *  TextBuffer is O(1) and the copy may be read from another thread
+ *  while the original keeps being edited.
+ *------------------------------------------------------------------*/
+class TextBuffer
+{
+public:
+  TextBuffer();
+  explicit TextBuffer(std::string_view text);
+  TextBuffer(const TextBuffer &other);
+  TextBuffer &operator=(const TextBuffer &other);
+  TextBuffer(TextBuffer &&other) noexcept;
+  TextBuffer &operator=(TextBuffer &&other) noexcept;
+  ~TextBuffer();
+
+  // ---- edits (byte offsets) ----
+  void insert(size_t offset, std::string_view text);
+  void remove(size_t offset, size_t length);
+  void setText(std::string_view text);
+
+  // ---- size ----
+  [[nodiscard]] size_t length() const;
+  [[nodiscard]] bool empty() const { return length() == 0; }
+  [[nodiscard]] uint32_t lineCount() const;
+  // Heap bytes held alive by this buffer (storage shared with copies included)
+  [[nodiscard]] size_t memoryUsage() const;
+
+  // ---- content ----
+  [[nodiscard]] std::string text() const;
+  [[nodiscard]] std::string substr(size_t offset, size_t length) const;
+  // Line contents without the terminating '\n'
+  [[nodiscard]] std::string line(uint32_t line) const;
+  // Contiguous bytes from offset to the end of the piece holding it (empty at end of buffer)
+  [[nodiscard]] std::string_view chunkAt(size_t offset) const;
+  template<typename F> void forEachChunk(size_t offset, size_t length, F &&f) const
+  {
+    while (length > 0) {
+      std::string_view chunk = chunkAt(offset);
+      if (chunk.empty()) return;
+      if (chunk.size() > length) chunk = chunk.substr(0, length);
+      f(chunk);
+      offset += chunk.size();
+      length -= chunk.size();
+    }
+  }
+
+  // ---- coordinates ----
+  [[nodiscard]] size_t lineStart(uint32_t line) const;
+  [[nodiscard]] size_t lineLength(uint32_t line) const;
+  [[nodiscard]] Core::Position positionFromOffset(size_t offset) const;
+  [[nodiscard]] size_t offsetFromPosition(Core::Position position) const;
+
+  // ---- UTF-16 (QString) offsets ----
+  [[nodiscard]] size_t utf16Length() const;
+  [[nodiscard]] size_t offsetFromUtf16(size_t units) const;
+  [[nodiscard]] size_t utf16FromOffset(size_t offset) const;
+
+private:
+  using NodePtr = std::shared_ptr<const detail::PieceNode>;
+
+  NodePtr makeNode(std::string_view text);
+  uint32_t nextPriority();
+
+  NodePtr m_root;
+  // Storage referenced by the pieces; shared with copies
+  std::vector<std::shared_ptr<detail::PieceChunk>> m_chunks;
+  // Append-only chunk that small inserts are copied into. Never shared
+  // for writing: copies start a fresh arena on their first insert.
+  detail::PieceChunk *m_arena = nullptr;
+  size_t m_arenaUsed          = 0;
+  uint32_t m_seed             = 0x9E3779B9u;
+};
+
+}// namespace CodeWizard::Editor
@@ -1,4 +1,8 @@
 #pragma once
+#include "Editor/CaptureFormats.h"
+#include "Editor/FoldingProvider.h"
+#include "Editor/InjectionLayers.h"
+#include "Editor/TextBuffer.h"
 #include "Editor/TreeSitterManager.h"
 #include <QElapsedTimer>
 #include <QSyntaxHighlighter>
@@ -6,6 +10,7 @@
 #include <QTimer>
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace CodeWizard::Editor {
@@ -18,6 +23,11 @@ struct HighlightStatistics {
     qint64 totalParseTimeMs = 0;
     qint64 totalHighlightTimeMs = 0;
     int lastMatchCount = 0;
+    int lastRehighlightedBlocks = 0; // Blocks re-formatted after the last parse
+    int backfilledBlocks = 0;        // Blocks formatted by idle-time slices (lazy mode)
+    int spanSweeps = 0;              // Query cursor walks that filled the span table
+    int injectionLayers = 0;         // Embedded-language regions after the last parse
+    int injectionReparses = 0;       // Of those, regions parsed again by the last parse
 
     void reset() { *this = HighlightStatistics{}; }
 };
@@ -29,12 +39,24 @@ public:
     explicit TreeSitterHighlighter(QTextDocument* parent);
     ~TreeSitterHighlighter() override;
 
+    // Returns true once the language is known; if its queries are still
+    // compiling, highlighting starts as soon as they are ready
     bool setLanguage(const QString& languageName);
     void clearLanguage();
+    bool isLanguagePending() const { return m_pendingLanguage.valid(); }
 
     void setTheme(const std::unordered_map<std::string, QTextCharFormat>& theme);
     void setThemeDefault();
 
+    // Lazy mode: only blocks inside the visible window (plus a margin) are
+    // formatted right away; the rest is filled in by short idle-time slices
+    void setLazyHighlighting(bool enabled);
+    bool lazyHighlighting() const { return m_lazy; }
+    void setVisibleBlocks(int firstBlock, int lastBlock);
+    // The visible blocks as sorted (first, last) runs: blocks hidden by a
+    // collapsed fold between two runs are not part of the window
+    void setVisibleRanges(std::vector<std::pair<int, int>> ranges);
+
     // Debug interface
     HighlightStatistics statistics() const { return m_stats; }
     void resetStatistics() { m_stats.reset(); }
@@ -49,12 +71,34 @@ public:
     void forceReparse();
 
     // Check if parser is healthy
-    bool isHealthy() const { return m_parser && m_tree && m_languageInfo; }
+    bool isHealthy() const { return m_tree && m_languageInfo; }
+
+    // Document version the current tree was parsed from (0 = no tree yet)
+    quint64 treeVersion() const { return m_treeVersion; }
+
+    // UTF-8 mirror of the document; copies are O(1) snapshots
+    const TextBuffer& buffer() const { return m_buffer; }
+    // False while no language is active or the highlighter is suspended: buffer() is stale then
+    bool mirrorsDocument() const { return m_languageInfo && !m_suspended; }
+
+    // Memory held for this document (text buffer, trees, span table), in bytes
+    size_t memoryUsage() const;
+
+    // Drop everything but the formats already applied (see HighlightBudget);
+    // resume() rebuilds it with one full parse
+    void suspend();
+    void resume();
+    bool isSuspended() const { return m_suspended; }
+
+    // Foldable regions from the language's folds.scm, refreshed by every parse
+    FoldingProvider& folding() { return m_folding; }
+    const FoldingProvider& folding() const { return m_folding; }
 
 signals:
     void parsingStarted();
     void parsingFinished(qint64 durationMs, bool incremental);
     void highlightError(const QString& error);
+    void foldsChanged();
 
 protected:
     void highlightBlock(const QString& text) override;
@@ -62,51 +106,129 @@ protected:
 private slots:
     void onDocumentContentsChanged(int position, int charsRemoved, int charsAdded);
     void processPendingChanges();
+    void pollPendingLanguage();
 
 private:
+    // State shared with the parse job running on Core::ThreadPool
+    struct ParseChannel;
+    using TreePtr = std::shared_ptr<TSTree>;
+    struct ParseResult {
+        TreePtr tree;
+        InjectionLayers injections;
+        QStringList pendingLanguages; // Injected languages whose queries were not ready
+        FoldRegions folds;
+    };
+
     // Tree-sitter core
-    TSParser* m_parser = nullptr;
-    TSTree* m_tree = nullptr;
+    std::shared_ptr<ParseChannel> m_channel; // Cancellation and delivery; outlives us while a job runs
+    TSTree* m_tree = nullptr;                // Edited in place on every keystroke (UI thread only)
     std::shared_ptr<LanguageInfo> m_languageInfo;
+    LanguageFuture m_pendingLanguage; // Set while the language's queries compile
+    QString m_pendingLanguageName;
+    QTimer* m_languagePollTimer;
 
-    // Document state tracking (for incremental sync)
-    QString m_lastText;        // Previous document text (UTF-16)
-    QByteArray m_lastUtf8;     // Previous document text (UTF-8)
+    // Versioning: bumped per edit, stamped on every parse job
+    quint64 m_version = 1;
+    quint64 m_treeVersion = 0;
+    bool m_parseInFlight = false;
+    bool m_reparsePending = false;
+    bool m_suspended = false;
+
+    // Embedded languages, edited along with m_tree and replaced by each parse
+    InjectionLayers m_injections;
+    QStringList m_pendingInjectionLanguages;
+
+    // Fold regions, edited along with m_tree and refreshed by each parse
+    FoldingProvider m_folding;
+
+    // Bytes edited since the tree was last replaced (new-text coordinates)
+    size_t m_dirtyStart = SIZE_MAX;
+    size_t m_dirtyEnd = 0;
+
+    // Document state tracking (for incremental sync): updated from the
+    // changed range only, never from a full copy of the document
+    TextBuffer m_buffer;       // Current document text, indexed for UTF-16 <-> UTF-8 lookups
 
     // Coalescing rapid edits
     QTimer* m_debounceTimer;
-    struct PendingEdit {
-        int position;
-        int charsRemoved;
-        int charsAdded;
-        bool valid = false;
-    } m_pendingEdit;
+
+    // Lazy highlighting: a block is up to date when its user data carries
+    // the current format generation
+    bool m_lazy = false;
+    std::vector<std::pair<int, int>> m_window{ { 0, 0 } }; // Visible runs of blocks, never empty
+    quint64 m_formatGeneration = 1;
+    bool m_forceFormat = false;
+    QTimer* m_backfillTimer;
+    int m_backfillBlock = 0;   // Next block the idle scan looks at
+    int m_backfillScanned = 0; // Blocks scanned since the last invalidation
+
+    // Captures of a line range, collected by one walk of a pooled query cursor.
+    // Spans of line L are m_spans[m_lineSpanOffsets[L - m_spanFirstLine] ...
+    // m_lineSpanOffsets[L - m_spanFirstLine + 1]), columns in UTF-16 units.
+    struct HighlightSpan {
+        uint32_t start;
+        uint32_t length;
+        uint16_t captureIndex;
+        uint16_t layer;       // 0 = host language, otherwise m_layerFormats index
+    };
+    std::vector<HighlightSpan> m_spans;
+    std::vector<uint32_t> m_lineSpanOffsets;
+    std::vector<std::pair<uint32_t, HighlightSpan>> m_spanScratch; // (line, span), reused
+    bool m_spansValid = false;
+    uint32_t m_spanFirstLine = 0;
+    uint32_t m_spanLastLine = 0;
 
     // Theme
-    std::unordered_map<std::string, QTextCharFormat> m_theme;
-    std::unordered_map<uint32_t, QTextCharFormat> m_captureIndexToFormat; // Cached mapping
+    std::shared_ptr<const HighlightTheme> m_theme;             // Interned, shared with other documents
+    std::shared_ptr<const CaptureFormatTable> m_captureFormats; // Shared per (language, theme)
+    // Same tables for injected languages; index 0 is unused (the host)
+    std::vector<std::pair<const LanguageInfo*, std::shared_ptr<const CaptureFormatTable>>> m_layerFormats;
 
     // Debug/Stats
     mutable HighlightStatistics m_stats;
-    bool m_isParsing = false;
 
-    // Offset conversion (uses m_lastUtf8 which corresponds to current tree)
+    // Offset conversion (uses m_buffer, kept in sync with the document)
+    TSInputEdit syncBuffer(int position, int charsRemoved, int charsAdded);
+    QString documentText(int position, int length) const;
     int charOffsetToByte(int charPos) const;
     int byteOffsetToChar(int bytePos) const;
-    int charOffsetToByte(int charPos, const QString& text) const;
 
-    // Parsing
-    void performIncrementalParse(int position, int charsRemoved, int charsAdded);
+    bool applyLanguage(const QString& languageName, std::shared_ptr<LanguageInfo> langInfo);
+
+    // Parsing (runs on Core::ThreadPool, results delivered to the UI thread)
+    void resetParser();
     void performFullParse();
-    void applyEditToTree(int startByte, int oldEndByte, int newEndByte);
+    void startParse(bool incremental);
+    void onParseFinished(std::shared_ptr<ParseResult> result, quint64 version, qint64 durationMs, bool incremental);
+    void applyEditToTree(TSInputEdit& edit, const TextBuffer& oldBuffer);
+
+    // Dirty-range tracking (rehighlight only what a parse actually changed)
+    void markDirty(const TSInputEdit& edit);
+    void clearDirty();
+    void rehighlightChangedRanges(const TSTree* oldTree, const TSTree* newTree);
+
+    // Lazy highlighting helpers
+    void rehighlightAll();
+    bool isInWindow(int blockNumber) const;
+    bool isFormatted(const QTextBlock& block) const;
+    void formatBlock(const QTextBlock& block);
+    void formatWindow();
+    void restartBackfill();
+    void backfillSlice();
 
     // Highlighting helpers
     void buildCaptureCache();
-    void highlightBlockRange(TSQueryCursor* cursor, const QString& text, int blockStart, int blockEnd);
+    uint16_t layerFormatsId(const LanguageInfo* language);
+    const QTextCharFormat* formatFor(uint16_t layer, uint32_t captureIndex) const;
+    void appendSpans(TSQueryCursor* cursor, const TSQuery* query, TSNode root, uint16_t layer, size_t startByte, size_t endByte);
+    void ensureSpans(uint32_t firstLine, uint32_t lastLine);
+    void collectSpans(uint32_t firstLine, uint32_t lastLine);
+    void invalidateSpans() { m_spansValid = false; }
 
     // Debug helpers
     void logNode(const TSNode& node, const char* context = "") const;
     std::string nodeString(const TSNode& node) const;
+    QString captureName(uint16_t layer, uint32_t captureIndex) const;
 };
 
 } // namespace CodeWizard::Editor
\ No newline at end of file
@@ -3,48 +3,93 @@
 #include <QHash>
 #include <QSharedPointer>
 #include <QString>
+#include <QStringList>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 #include <tree_sitter/api.h>
 namespace CodeWizard::Editor {
-// Language metadata
+// Language metadata. Built on a worker thread by TreeSitterManager::loadLanguage
+// and immutable once published through the future.
 struct LanguageInfo
 {
   const TSLanguage *language;
   QString name;
+  QString queryDir;
   QString queryPath;
   TSQuery *highlightQuery = nullptr;
+  qint64 queryCompileMs   = 0;
+
+  // injections.scm (optional): which captured nodes hold another language
+  TSQuery *injectionQuery           = nullptr;
+  uint32_t injectionContentCapture  = UINT32_MAX;// @injection.content
+  uint32_t injectionLanguageCapture = UINT32_MAX;// @injection.language (node text names the language)
+  std::vector<QString> injectionPatternLanguages;// #set! injection.language "name", per pattern
+
+  // folds.scm (optional): nodes that can be collapsed
+  TSQuery *foldQuery   = nullptr;
+  uint32_t foldCapture = UINT32_MAX;// @fold
 
   LanguageInfo() : language(nullptr), highlightQuery(nullptr) {}
   ~LanguageInfo()
   {
     if (highlightQuery) ts_query_delete(highlightQuery);
+    if (injectionQuery) ts_query_delete(injectionQuery);
+    if (foldQuery) ts_query_delete(foldQuery);
   }
 };
 
+using LanguageFuture = std::shared_future<std::shared_ptr<LanguageInfo>>;
+
 class TreeSitterManager
 {
 public:
   static TreeSitterManager &instance();
 
-  // Initialize with path to queries directory
+  // Initialize with path to queries directory (registers descriptors only)
   void initialize(const QString &queriesRootPath);
 
-  // Register a language
+  // Register a language: cheap, nothing is loaded until the language is first used
   void registerLanguage(const QString &name, const TSLanguage *langFunc(), const QString &querySubdir);
 
-  // Get language info
-  std::shared_ptr<LanguageInfo> getLanguage(const QString &name) const;
+  // Start compiling the language's queries on Core::ThreadPool (first call
+  // only) and return the shared result. Invalid future for unknown languages.
+  LanguageFuture loadLanguage(const QString &name);
+
+  // Blocking variant of loadLanguage; nullptr for unknown languages
+  std::shared_ptr<LanguageInfo> getLanguage(const QString &name);
 
   // Available languages
-  std::ranges::elements_view<std::ranges::ref_view<const std::unordered_map<QString, std::shared_ptr<LanguageInfo>>>, 0>
-    availableLanguages() const;
+  std::vector<QString> availableLanguages() const;
+
+  // Time spent in initialize(), in microseconds
+  qint64 initializeTimeUs() const { return m_initializeTimeUs; }
 
 private:
   TreeSitterManager() = default;
   ~TreeSitterManager();
 
-  std::unordered_map<QString, std::shared_ptr<LanguageInfo>> m_languages;
+  struct LanguageDescriptor
+  {
+    const TSLanguage *(*factory)() = nullptr;
+    QString querySubdir;
+    LanguageFuture future;// Valid once loading has started
+  };
+
+  mutable std::mutex m_mutex;
+  std::unordered_map<QString, LanguageDescriptor> m_languages;
   QString m_queriesRoot;
+  qint64 m_initializeTimeUs = 0;
 
-  bool loadQuery(LanguageInfo &info);
+  bool loadQuery(LanguageInfo &info) const;
+  // Resolved and compiled query `kind` ("highlights", "injections"); nullptr if absent or invalid
+  TSQuery *loadQuery(const LanguageInfo &info, const QString &kind) const;
+  // Query text with `; inherits:` parents prepended; null if the file is missing
+  QByteArray readQuerySource(const QString &queryDir, const QString &kind, int depth = 0) const;
+  TSQuery *compileQuery(const LanguageInfo &info, const QByteArray &source, const QString &kind) const;
+  static void resolveInjectionMetadata(LanguageInfo &info);
 };
-}// namespace CodeWizard::Editor
\ No newline at end of file
+}// namespace CodeWizard::Editor
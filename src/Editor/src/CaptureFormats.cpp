@@ -0,0 +1,59 @@
+#include "Editor/CaptureFormats.h"
+#include <algorithm>
+
+namespace CodeWizard::Editor {
+
+CaptureFormats &CaptureFormats::instance()
+{
+  static CaptureFormats instance;
+  return instance;
+}
+
+std::shared_ptr<const HighlightTheme> CaptureFormats::intern(const HighlightTheme &theme)
+{
+  std::erase_if(m_themes, [](const auto &entry) { return entry.expired(); });
+  for (const auto &entry : m_themes) {
+    if (auto existing = entry.lock(); existing && *existing == theme) return existing;
+  }
+  auto interned = std::make_shared<const HighlightTheme>(theme);
+  m_themes.push_back(interned);
+  return interned;
+}
+
+std::shared_ptr<const CaptureFormatTable> CaptureFormats::table(const TSQuery *query,
+  const std::shared_ptr<const HighlightTheme> &theme)
+{
+  if (!query || !theme) return nullptr;
+
+  const auto key = std::make_pair(query, theme.get());
+  if (auto it = m_tables.find(key); it != m_tables.end()) {
+    if (auto existing = it->second.lock()) return existing;
+  }
+
+  auto table   = std::make_shared<CaptureFormatTable>();
+  table->theme = theme;
+  const uint32_t count = ts_query_capture_count(query);
+  table->formats.assign(count, nullptr);
+
+  std::string name;// One buffer for every lookup: shrinking it to a parent name never reallocates
+  for (uint32_t i = 0; i < count; ++i) {
+    uint32_t length   = 0;
+    const char *chars = ts_query_capture_name_for_id(query, i, &length);
+    name.assign(chars, length);
+    while (true) {
+      if (auto it = theme->find(name); it != theme->end()) {
+        table->formats[i] = &it->second;
+        break;
+      }
+      const size_t dot = name.find_last_of('.');
+      if (dot == std::string::npos) break;
+      name.resize(dot);
+    }
+  }
+
+  std::erase_if(m_tables, [](const auto &entry) { return entry.second.expired(); });
+  m_tables[key] = table;
+  return table;
+}
+
+}// namespace CodeWizard::Editor
@@ -1,12 +1,16 @@
 #include "Editor/CodeTextEdit.h"
+#include "Editor/HighlightBudget.h"
 #include <QAbstractTextDocumentLayout>
 #include <QApplication>
 #include <QFontDatabase>
+#include <QMouseEvent>
 #include <QPainter>
 #include <QTextBlock>
 #include <QTextCursor>
 #include <QTextDocument>
 #include <limits>
+#include <utility>
+#include <vector>
 
 class LineNumberArea;
 namespace CodeWizard::Editor {
@@ -29,6 +33,11 @@ CodeTextEdit::CodeTextEdit(QWidget *parent) : QPlainTextEdit(parent)
   // Initial setup
   updateLineNumberAreaWidth();
   m_highlighter = std::make_unique<CodeWizard::Editor::TreeSitterHighlighter>(document());
+
+  // Highlight what is on screen first, the rest of the file in idle time
+  m_highlighter->setLazyHighlighting(true);
+  connect(this, &QPlainTextEdit::updateRequest, this, &CodeTextEdit::updateHighlightWindow);
+  connect(m_highlighter.get(), &TreeSitterHighlighter::foldsChanged, this, &CodeTextEdit::onFoldsChanged);
 }
 
 void CodeTextEdit::setLanguage(const std::string &languageId)
@@ -36,6 +45,13 @@ void CodeTextEdit::setLanguage(const std::string &languageId)
   if (m_highlighter) { m_highlighter->setLanguage("cpp"); }
 }
 
+TextBuffer CodeTextEdit::snapshot() const
+{
+  if (m_highlighter && m_highlighter->mirrorsDocument()) return m_highlighter->buffer();
+  const QByteArray utf8 = document()->toPlainText().toUtf8();
+  return TextBuffer(std::string_view(utf8.constData(), static_cast<size_t>(utf8.size())));
+}
+
 void CodeTextEdit::applyTheme()
 {
   const auto &theme  = CodeWizard::Theme::ThemeEngine::instance();
@@ -68,10 +84,13 @@ int CodeTextEdit::lineNumberAreaWidth()
   }
 
   QFontMetrics fm(font);
-  int space = 10 + fm.horizontalAdvance(QLatin1Char('9')) * digits;
+  int space = 10 + fm.horizontalAdvance(QLatin1Char('9')) * digits + foldMarkerWidth();
   return space;
 }
 
+// Fold markers sit in a square column right of the line numbers
+int CodeTextEdit::foldMarkerWidth() const { return fontMetrics().height(); }
+
 void CodeTextEdit::updateLineNumberAreaWidth() { setViewportMargins(lineNumberAreaWidth(), 0, 0, 0); }
 
 void CodeTextEdit::updateLineNumberArea(const QRect &rect, int dy)
@@ -85,6 +104,32 @@ void CodeTextEdit::updateLineNumberArea(const QRect &rect, int dy)
   if (rect.contains(viewport()->rect())) { updateLineNumberAreaWidth(); }
 }
 
+void CodeTextEdit::updateHighlightWindow()
+{
+  if (!m_highlighter) return;
+  // Walk the visible blocks down to the bottom edge, jumping over collapsed
+  // folds: their lines are neither visited nor handed to the highlighter
+  const FoldingProvider &folding = m_highlighter->folding();
+  std::vector<std::pair<int, int>> ranges;
+  QTextBlock block   = firstVisibleBlock();
+  qreal top          = blockBoundingGeometry(block).translated(contentOffset()).top();
+  const qreal bottom = viewport()->height();
+  while (block.isValid() && top <= bottom) {
+    const int number = block.blockNumber();
+    if (block.isVisible()) {
+      if (!ranges.empty() && ranges.back().second == number - 1) {
+        ranges.back().second = number;
+      } else {
+        ranges.emplace_back(number, number);
+      }
+      top += blockBoundingRect(block).height();
+    }
+    const FoldRegion *fold = folding.collapsedAt(static_cast<uint32_t>(number));
+    block = fold ? document()->findBlockByNumber(static_cast<int>(fold->lastHiddenLine()) + 1) : block.next();
+  }
+  m_highlighter->setVisibleRanges(std::move(ranges));
+}
+
 void CodeTextEdit::resizeEvent(QResizeEvent *e)
 {
   QPlainTextEdit::resizeEvent(e);
@@ -95,6 +140,13 @@ void CodeTextEdit::resizeEvent(QResizeEvent *e)
 
 void CodeTextEdit::paintEvent(QPaintEvent *e) { QPlainTextEdit::paintEvent(e); }
 
+void CodeTextEdit::focusInEvent(QFocusEvent *e)
+{
+  QPlainTextEdit::focusInEvent(e);
+  // Most recently focused documents keep their highlighter state; others may be suspended
+  if (m_highlighter) HighlightBudget::instance().touch(m_highlighter.get());
+}
+
 void CodeTextEdit::lineNumberAreaPaintEvent(QPaintEvent *event)
 {
   QPainter painter(m_lineNumberArea);
@@ -117,18 +169,103 @@ void CodeTextEdit::lineNumberAreaPaintEvent(QPaintEvent *event)
   int top          = static_cast<int>(blockBoundingGeometry(block).translated(contentOffset()).top());
   int bottom       = top + static_cast<int>(blockBoundingRect(block).height());
 
-  // Paint line numbers
+  const FoldingProvider *folding = m_highlighter ? &m_highlighter->folding() : nullptr;
+  const int lineHeight           = fontMetrics().height();
+  const int markerWidth          = foldMarkerWidth();
+  const int markerLeft           = m_lineNumberArea->width() - markerWidth;
+
+  // Paint line numbers and fold markers
   while (block.isValid() && top <= event->rect().bottom()) {
+    const FoldRegion *fold = folding ? folding->regionAt(static_cast<uint32_t>(blockNumber)) : nullptr;
     if (block.isVisible() && bottom >= event->rect().top()) {
       QString number = QString::number(blockNumber + 1);
-      painter.drawText(0, top, m_lineNumberArea->width() - 4, fontMetrics().height(), Qt::AlignRight, number);
+      painter.drawText(0, top, markerLeft - 4, lineHeight, Qt::AlignRight, number);
+      if (fold) {
+        painter.drawText(markerLeft, top, markerWidth, lineHeight, Qt::AlignCenter, QString(QChar(fold->collapsed ? 0x25B8 : 0x25BE)));
+      }
     }
 
-    block = block.next();
-    ++blockNumber;
-    top    = bottom;
-    bottom = top + static_cast<int>(blockBoundingRect(block).height());
+    // Hidden blocks take no space: jump over a collapsed region instead of visiting each of its lines
+    if (fold && fold->collapsed) {
+      block = document()->findBlockByNumber(static_cast<int>(fold->lastHiddenLine()) + 1);
+    } else {
+      block = block.next();
+    }
+    blockNumber = block.blockNumber();
+    top         = bottom;
+    bottom      = top + static_cast<int>(blockBoundingRect(block).height());
+  }
+}
+
+void CodeTextEdit::lineNumberAreaMousePressEvent(QMouseEvent *event)
+{
+  // Only the marker column toggles folds
+  if (event->position().x() < m_lineNumberArea->width() - foldMarkerWidth()) return;
+  const QTextCursor cursor = cursorForPosition(QPoint(0, event->position().toPoint().y()));
+  toggleFold(cursor.blockNumber());
+  event->accept();
+}
+
+void CodeTextEdit::toggleFold(int line)
+{
+  if (!m_highlighter || line < 0) return;
+  FoldRegion *region = m_highlighter->folding().regionAt(static_cast<uint32_t>(line));
+  if (!region) return;
+
+  region->collapsed = !region->collapsed;
+  const bool collapsed = region->collapsed;
+  const int first      = static_cast<int>(region->firstHiddenLine());
+  const int last       = static_cast<int>(region->lastHiddenLine());
+
+  // The cursor must not end up inside hidden text: park it on the header
+  if (collapsed && textCursor().blockNumber() >= first && textCursor().blockNumber() <= last) {
+    QTextCursor cursor(document()->findBlockByNumber(line));
+    cursor.movePosition(QTextCursor::EndOfBlock);
+    setTextCursor(cursor);
+  }
+  setLinesVisible(first, last, !collapsed);
+}
+
+void CodeTextEdit::setLinesVisible(int first, int last, bool visible)
+{
+  const FoldingProvider &folding = m_highlighter->folding();
+  QTextBlock block               = document()->findBlockByNumber(first);
+  if (!block.isValid()) return;
+  const int start = block.position();
+  int end         = start;
+
+  while (block.isValid() && block.blockNumber() <= last) {
+    block.setVisible(visible);
+    end = block.position() + block.length();
+    // Expanding a region leaves the regions collapsed inside it folded
+    const FoldRegion *nested = visible ? folding.collapsedAt(static_cast<uint32_t>(block.blockNumber())) : nullptr;
+    if (nested && static_cast<int>(nested->lastHiddenLine()) <= last) {
+      block = document()->findBlockByNumber(static_cast<int>(nested->lastHiddenLine()) + 1);
+    } else {
+      block = block.next();
+    }
+  }
+
+  // Relayout only the affected blocks
+  document()->markContentsDirty(start, end - start);
+  viewport()->update();
+  m_lineNumberArea->update();
+}
+
+void CodeTextEdit::onFoldsChanged()
+{
+  // Collapsed regions the last parse dropped show their lines again; the
+  // ones still collapsed hide theirs again in case they overlapped
+  const auto released = m_highlighter->folding().takeReleased();
+  for (const auto &[first, last] : released) setLinesVisible(static_cast<int>(first), static_cast<int>(last), true);
+  if (!released.empty()) {
+    for (const FoldRegion &region : m_highlighter->folding().regions()) {
+      if (region.collapsed) {
+        setLinesVisible(static_cast<int>(region.firstHiddenLine()), static_cast<int>(region.lastHiddenLine()), false);
+      }
+    }
   }
+  m_lineNumberArea->update();
 }
 
 void CodeTextEdit::wheelEvent(QWheelEvent *e)
@@ -0,0 +1,150 @@
+#include "Editor/FoldingProvider.h"
+#include "Editor/InjectionLayers.h"
+#include "Editor/ParserPool.h"
+#include <algorithm>
+
+namespace CodeWizard::Editor {
+
+namespace {
+  bool startsBefore(const FoldRegion &a, const FoldRegion &b)
+  {
+    // Outer regions first when two start at the same byte
+    return a.range.start_byte != b.range.start_byte ? a.range.start_byte < b.range.start_byte
+                                                    : a.range.end_byte > b.range.end_byte;
+  }
+
+  // "}" / ")" / "]" alone at the start of the region's last line
+  bool endsWithClosingLine(const TSRange &range, const TextBuffer &text)
+  {
+    if (range.end_byte == 0) return false;
+    const std::string last = text.substr(range.end_byte - 1, 1);
+    if (last != "}" && last != ")" && last != "]") return false;
+    const size_t lineStart = text.lineStart(range.end_point.row);
+    const std::string before = text.substr(lineStart, range.end_byte - 1 - lineStart);
+    return std::all_of(before.begin(), before.end(), [](char c) { return c == ' ' || c == '\t'; });
+  }
+}// namespace
+
+FoldRegions findFolds(const LanguageInfo &language,
+  const TSTree *tree,
+  const TextBuffer &text,
+  FoldRegions previous,
+  const std::vector<std::pair<size_t, size_t>> &changed,
+  bool full)
+{
+  FoldRegions result;
+  if (!language.foldQuery || language.foldCapture == UINT32_MAX || !tree) return result;
+
+  std::vector<std::pair<size_t, size_t>> ranges = changed;
+  if (full) ranges.assign(1, { 0, text.length() });
+  auto touchesChange = [&ranges](const TSRange &range) {
+    return std::any_of(ranges.begin(), ranges.end(), [&range](const auto &change) {
+      return range.start_byte <= change.second && change.first <= range.end_byte;
+    });
+  };
+  for (FoldRegion &region : previous) {
+    if (!full && !touchesChange(region.range)) result.push_back(region);
+  }
+
+  const CursorLease cursor = ParserPool::instance().acquireCursor();
+  const TSNode root        = ts_tree_root_node(tree);
+  for (const auto &[start, end] : ranges) {
+    ts_query_cursor_set_byte_range(cursor.get(), static_cast<uint32_t>(start), static_cast<uint32_t>(end));
+    ts_query_cursor_exec(cursor.get(), language.foldQuery, root);
+
+    TSQueryMatch match;
+    while (ts_query_cursor_next_match(cursor.get(), &match)) {
+      // A quantified capture ("(preproc_include)+ @fold") folds the whole run
+      bool found = false;
+      TSRange range{};
+      for (uint16_t i = 0; i < match.capture_count; ++i) {
+        const TSQueryCapture &capture = match.captures[i];
+        if (capture.index != language.foldCapture) continue;
+        const TSNode node = capture.node;
+        if (!found || ts_node_start_byte(node) < range.start_byte) {
+          range.start_byte  = ts_node_start_byte(node);
+          range.start_point = ts_node_start_point(node);
+        }
+        if (!found || ts_node_end_byte(node) > range.end_byte) {
+          range.end_byte  = ts_node_end_byte(node);
+          range.end_point = ts_node_end_point(node);
+        }
+        found = true;
+      }
+      if (!found || range.end_point.row <= range.start_point.row) continue;
+
+      FoldRegion region;
+      region.range = range;
+      // Nodes that end with their line break leave nothing on the last line
+      region.keepLastLine = range.end_point.column == 0 || endsWithClosingLine(range, text);
+      if (region.lastHiddenLine() < region.firstHiddenLine()) continue;
+      result.push_back(region);
+    }
+  }
+
+  // Overlapping changed ranges and kept regions can report the same node twice
+  std::sort(result.begin(), result.end(), startsBefore);
+  result.erase(std::unique(result.begin(),
+                 result.end(),
+                 [](const FoldRegion &a, const FoldRegion &b) {
+                   return a.range.start_byte == b.range.start_byte && a.range.end_byte == b.range.end_byte;
+                 }),
+    result.end());
+  return result;
+}
+
+void FoldingProvider::clear()
+{
+  for (const FoldRegion &region : m_regions) {
+    if (region.collapsed) m_released.emplace_back(region.firstHiddenLine(), region.lastHiddenLine());
+  }
+  m_regions.clear();
+}
+
+void FoldingProvider::edit(const TSInputEdit &edit)
+{
+  for (FoldRegion &region : m_regions) editRange(region.range, edit);
+}
+
+void FoldingProvider::adopt(FoldRegions regions)
+{
+  // Both lists are sorted and in the same (current) coordinates: carry the
+  // collapsed state over by start and end byte
+  auto next = regions.begin();
+  for (const FoldRegion &old : m_regions) {
+    if (!old.collapsed) continue;
+    next = std::lower_bound(next, regions.end(), old, startsBefore);
+    if (next != regions.end() && next->range.start_byte == old.range.start_byte
+        && next->range.end_byte == old.range.end_byte) {
+      next->collapsed = true;
+    } else {
+      m_released.emplace_back(old.firstHiddenLine(), old.lastHiddenLine());
+    }
+  }
+  m_regions = std::move(regions);
+}
+
+FoldRegion *FoldingProvider::regionAt(uint32_t line)
+{
+  // Sorted by start byte, so header lines are sorted too; the first hit is the outermost
+  auto it = std::lower_bound(
+    m_regions.begin(), m_regions.end(), line, [](const FoldRegion &region, uint32_t l) { return region.headerLine() < l; });
+  return it != m_regions.end() && it->headerLine() == line ? &*it : nullptr;
+}
+
+const FoldRegion *FoldingProvider::regionAt(uint32_t line) const
+{
+  return const_cast<FoldingProvider *>(this)->regionAt(line);
+}
+
+const FoldRegion *FoldingProvider::collapsedAt(uint32_t line) const
+{
+  auto it = std::lower_bound(
+    m_regions.begin(), m_regions.end(), line, [](const FoldRegion &region, uint32_t l) { return region.headerLine() < l; });
+  for (; it != m_regions.end() && it->headerLine() == line; ++it) {
+    if (it->collapsed) return &*it;
+  }
+  return nullptr;
+}
+
+}// namespace CodeWizard::Editor
@@ -0,0 +1,93 @@
+#include "Editor/HighlightBudget.h"
+#include "Editor/HighlighterLogging.h"
+#include "Editor/TreeSitterHighlighter.h"
+#include <Core/Config.h>
+#include <algorithm>
+
+namespace CodeWizard::Editor {
+
+HighlightBudget &HighlightBudget::instance()
+{
+  static HighlightBudget instance;
+  return instance;
+}
+
+void HighlightBudget::add(TreeSitterHighlighter *highlighter)
+{
+  // A document that was just opened counts as focused
+  m_entries.push_back({ highlighter, ++m_focusClock });
+}
+
+void HighlightBudget::remove(TreeSitterHighlighter *highlighter)
+{
+  std::erase_if(m_entries, [highlighter](const Entry &entry) { return entry.highlighter == highlighter; });
+}
+
+void HighlightBudget::touch(TreeSitterHighlighter *highlighter)
+{
+  auto it = std::find_if(
+    m_entries.begin(), m_entries.end(), [highlighter](const Entry &entry) { return entry.highlighter == highlighter; });
+  if (it == m_entries.end()) return;
+  it->lastFocus = ++m_focusClock;
+  if (highlighter->isSuspended()) highlighter->resume();
+  enforce();
+}
+
+size_t HighlightBudget::budgetBytes() const
+{
+  const int megabytes = Core::Config::instance().getInt(kConfigKey).value_or(kDefaultBudgetMB);
+  return static_cast<size_t>(std::max(megabytes, 0)) * 1024 * 1024;
+}
+
+size_t HighlightBudget::totalBytes() const
+{
+  size_t total = 0;
+  for (const Entry &entry : m_entries) total += entry.highlighter->memoryUsage();
+  return total;
+}
+
+void HighlightBudget::enforce()
+{
+  const size_t budget = budgetBytes();
+  if (budget == 0 || m_entries.size() < 2) return;
+
+  size_t total = totalBytes();
+  if (total <= budget) return;
+
+  // Oldest focus first; the focused document itself is never suspended
+  std::vector<Entry> candidates = m_entries;
+  std::sort(candidates.begin(), candidates.end(), [](const Entry &a, const Entry &b) {
+    return a.lastFocus < b.lastFocus;
+  });
+  candidates.pop_back();
+
+  for (const Entry &entry : candidates) {
+    if (total <= budget) break;
+    if (entry.highlighter->isSuspended()) continue;
+    const size_t before = entry.highlighter->memoryUsage();
+    entry.highlighter->suspend();
+    const size_t freed = before - std::min(before, entry.highlighter->memoryUsage());
+    total -= std::min(total, freed);
+    ++m_evictions;
+    qCDebug(lcHighlighter) << "Suspended" << entry.highlighter->document()->metaInformation(QTextDocument::DocumentUrl)
+                           << "freeing" << freed / 1024 << "KiB; highlighters now use" << total / 1024 << "of"
+                           << budget / 1024 << "KiB";
+  }
+}
+
+std::vector<DocumentMemory> HighlightBudget::report() const
+{
+  std::vector<Entry> entries = m_entries;
+  std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) { return a.lastFocus > b.lastFocus; });
+
+  std::vector<DocumentMemory> report;
+  report.reserve(entries.size());
+  for (const Entry &entry : entries) {
+    report.push_back({ entry.highlighter->document()->metaInformation(QTextDocument::DocumentUrl),
+      entry.highlighter->memoryUsage(),
+      entry.highlighter->isSuspended() });
+  }
+  return report;
+}
+
+}// namespace CodeWizard::Editor
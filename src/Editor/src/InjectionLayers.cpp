@@ -0,0 +1,173 @@
+#include "Editor/InjectionLayers.h"
+#include "Editor/ParserPool.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace CodeWizard::Editor {
+
+namespace {
+  void shiftPosition(uint32_t &byte, TSPoint &point, const TSInputEdit &edit, bool isEnd)
+  {
+    if (byte >= edit.old_end_byte) {
+      byte = byte - edit.old_end_byte + edit.new_end_byte;
+      if (point.row == edit.old_end_point.row) point.column = point.column - edit.old_end_point.column + edit.new_end_point.column;
+      point.row = point.row - edit.old_end_point.row + edit.new_end_point.row;
+    } else if (byte > edit.start_byte) {
+      byte  = isEnd ? edit.new_end_byte : edit.start_byte;
+      point = isEnd ? edit.new_end_point : edit.start_point;
+    }
+  }
+
+  void mergeRanges(std::vector<std::pair<size_t, size_t>> &ranges)
+  {
+    std::sort(ranges.begin(), ranges.end());
+    std::vector<std::pair<size_t, size_t>> merged;
+    for (const auto &range : ranges) {
+      if (!merged.empty() && range.first <= merged.back().second) {
+        merged.back().second = std::max(merged.back().second, range.second);
+      } else {
+        merged.push_back(range);
+      }
+    }
+    ranges = std::move(merged);
+  }
+
+  const char *readBuffer(void *payload, uint32_t byteIndex, TSPoint, uint32_t *bytesRead)
+  {
+    const std::string_view chunk = static_cast<const TextBuffer *>(payload)->chunkAt(byteIndex);
+    *bytesRead                   = static_cast<uint32_t>(chunk.size());
+    return chunk.data();
+  }
+}// namespace
+
+void editRange(TSRange &range, const TSInputEdit &edit)
+{
+  shiftPosition(range.start_byte, range.start_point, edit, false);
+  shiftPosition(range.end_byte, range.end_point, edit, true);
+}
+
+void editInjectionLayers(InjectionLayers &layers, const TSInputEdit &edit)
+{
+  for (InjectionLayer &layer : layers) {
+    if (layer.tree) ts_tree_edit(layer.tree.get(), &edit);
+    editRange(layer.range, edit);
+  }
+}
+
+InjectionLayers InjectionEngine::update(const LanguageInfo &host,
+  const TSTree *hostTree,
+  const TextBuffer &text,
+  InjectionLayers previous,
+  std::vector<std::pair<size_t, size_t>> changed,
+  bool full,
+  QStringList &pending)
+{
+  InjectionLayers result;
+  if (!host.injectionQuery || host.injectionContentCapture == UINT32_MAX) return result;
+
+  if (full) changed.assign(1, { 0, text.length() });
+  mergeRanges(changed);
+  auto touchesChange = [&changed](const TSRange &range) {
+    return std::any_of(changed.begin(), changed.end(), [&range](const auto &change) {
+      return range.start_byte <= change.second && change.first <= range.end_byte;
+    });
+  };
+
+  // Layers away from every change are kept as they are
+  InjectionLayers replaced;
+  for (InjectionLayer &layer : previous) {
+    layer.reparsed = false;
+    (full || touchesChange(layer.range) ? replaced : result).push_back(std::move(layer));
+  }
+
+  // Find the injected regions inside the changed ranges
+  const CursorLease cursor = ParserPool::instance().acquireCursor();
+  const TSNode root        = ts_tree_root_node(hostTree);
+  InjectionLayers found;
+  std::unordered_set<uint64_t> seen;                   // Start and end byte of each region taken
+  std::unordered_map<QString, LanguageFuture> languages;// One manager lookup per language, not per match
+  for (const auto &[start, end] : changed) {
+    ts_query_cursor_set_byte_range(cursor.get(), static_cast<uint32_t>(start), static_cast<uint32_t>(end));
+    ts_query_cursor_exec(cursor.get(), host.injectionQuery, root);
+
+    TSQueryMatch match;
+    while (ts_query_cursor_next_match(cursor.get(), &match)) {
+      QString languageName;
+      if (match.pattern_index < host.injectionPatternLanguages.size()) {
+        languageName = host.injectionPatternLanguages[match.pattern_index];
+      }
+      TSNode content{};
+      bool hasContent = false;
+      for (uint16_t i = 0; i < match.capture_count; ++i) {
+        const TSQueryCapture &capture = match.captures[i];
+        if (capture.index == host.injectionContentCapture) {
+          content    = capture.node;
+          hasContent = true;
+        } else if (capture.index == host.injectionLanguageCapture) {
+          const uint32_t from = ts_node_start_byte(capture.node);
+          languageName = QString::fromStdString(text.substr(from, ts_node_end_byte(capture.node) - from)).trimmed().toLower();
+        }
+      }
+      if (!hasContent || languageName.isEmpty()) continue;
+
+      const TSRange range{ ts_node_start_point(content), ts_node_end_point(content), ts_node_start_byte(content), ts_node_end_byte(content) };
+      if (range.end_byte <= range.start_byte) continue;
+      // Several patterns may claim the same node (comment, doxygen...): the first one with a grammar wins
+      const uint64_t key = static_cast<uint64_t>(range.start_byte) << 32 | range.end_byte;
+      if (seen.contains(key)) continue;
+
+      auto known = languages.find(languageName);
+      if (known == languages.end()) {
+        known = languages.emplace(languageName, TreeSitterManager::instance().loadLanguage(languageName)).first;
+      }
+      const LanguageFuture &future = known->second;
+      if (!future.valid()) continue;// No grammar for it
+      seen.insert(key);
+      if (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        if (!pending.contains(languageName)) pending << languageName;
+        continue;
+      }
+      std::shared_ptr<LanguageInfo> language = future.get();
+      if (!language->language || !language->highlightQuery) continue;
+      found.push_back({ std::move(language), range, nullptr, true });
+    }
+  }
+
+  // Parse each region on its own, reusing the old tree of the same language where there was one
+  TSInput input{};
+  input.payload  = const_cast<TextBuffer *>(&text);
+  input.encoding = TSInputEncodingUTF8;
+  input.read     = readBuffer;
+  for (InjectionLayer &layer : found) {
+    const TSTree *oldTree = nullptr;
+    for (const InjectionLayer &old : replaced) {
+      if (old.language == layer.language && old.tree && old.range.start_byte < layer.range.end_byte
+          && layer.range.start_byte < old.range.end_byte) {
+        oldTree = old.tree.get();
+        break;
+      }
+    }
+
+    const ParserLease parser = ParserPool::instance().acquireParser(layer.language->language);
+    if (!parser) continue;
+    ts_parser_set_cancellation_flag(parser.get(), &m_cancelFlag);
+    ts_parser_set_included_ranges(parser.get(), &layer.range, 1);
+    TSTree *tree = ts_parser_parse(parser.get(), oldTree, input);
+    if (!tree) {
+      if (std::atomic_ref<size_t>(m_cancelFlag).load(std::memory_order_relaxed)) break;
+      continue;
+    }
+    layer.tree.reset(tree, ts_tree_delete);
+    result.push_back(std::move(layer));
+  }
+
+  std::sort(result.begin(), result.end(), [](const InjectionLayer &a, const InjectionLayer &b) {
+    return a.range.start_byte < b.range.start_byte;
+  });
+  return result;
+}
+
+}// namespace CodeWizard::Editor
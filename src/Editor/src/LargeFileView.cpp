@@ -0,0 +1,217 @@
+#include "Editor/LargeFileView.h"
+#include <QKeyEvent>
+#include <QPainter>
+#include <QScrollBar>
+#include <Theme/ThemeEngine.h>
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+
+namespace CodeWizard::Editor {
+
+namespace {
+  constexpr size_t kIndexSliceBytes = 4 * 1024 * 1024;// ~1 ms warm, a few ms from disk
+  constexpr size_t kMaxPaintedBytes = 16 * 1024;      // Per row: longer lines wrap onto continuation rows
+
+  LineIndex::CodeUnit codeUnitFor(QStringConverter::Encoding encoding)
+  {
+    switch (encoding) {
+    case QStringConverter::Utf16LE:
+      return LineIndex::CodeUnit::Utf16LE;
+    case QStringConverter::Utf16BE:
+      return LineIndex::CodeUnit::Utf16BE;
+    default:
+      return LineIndex::CodeUnit::Byte;
+    }
+  }
+}// namespace
+
+LargeFileView::LargeFileView(Platform::MappedFile file,
+  QStringConverter::Encoding encoding,
+  size_t bomLength,
+  QWidget *parent)
+  : QAbstractScrollArea(parent), m_file(std::move(file)), m_encoding(encoding), m_bomLength(bomLength),
+    m_index(m_file.view().substr(bomLength), codeUnitFor(encoding)), m_indexTimer(new QTimer(this))
+{
+  applyTheme();
+  setFocusPolicy(Qt::StrongFocus);
+
+  // The index is built front to back: let the OS read ahead
+  m_file.advise(Platform::MappedFile::Advice::Sequential);
+  m_indexTimer->setInterval(0);
+  connect(m_indexTimer, &QTimer::timeout, this, &LargeFileView::indexSlice);
+  m_indexTimer->start();
+  // Scrolling by hand ends a pending jump
+  connect(verticalScrollBar(), &QAbstractSlider::actionTriggered, this, [this]() { m_following = false; });
+  updateScrollRanges();
+}
+
+void LargeFileView::applyTheme()
+{
+  const auto &theme = CodeWizard::Theme::ThemeEngine::instance();
+  setFont(theme.fonts().codeFont);
+
+  QPalette palette;
+  palette.setColor(QPalette::Base, theme.colors().editorBackground);
+  palette.setColor(QPalette::Text, theme.colors().editorForeground);
+  setPalette(palette);
+}
+
+void LargeFileView::gotoLine(size_t line)
+{
+  // Past the index the line is shown where it is estimated to be; the
+  // idle slices keep the view on it until they have found it exactly
+  m_targetLine = line;
+  m_following  = true;
+  followTarget();
+}
+
+void LargeFileView::followTarget()
+{
+  if (!m_following) return;
+  verticalScrollBar()->setValue(static_cast<int>(std::min<size_t>(m_targetLine, INT_MAX)));
+  if (m_index.isComplete() || m_index.isLineIndexed(m_targetLine)) m_following = false;
+}
+
+void LargeFileView::indexSlice()
+{
+  const size_t from = m_index.indexedBytes();
+  const bool done   = m_index.buildSome(kIndexSliceBytes);
+  // Scanned pages are not needed any more; visible ones come back on the next paint
+  m_file.advise(Platform::MappedFile::Advice::DontNeed, m_bomLength + from, m_index.indexedBytes() - from);
+  updateScrollRanges();
+  followTarget();
+  if (done) {
+    m_indexTimer->stop();
+    m_file.advise(Platform::MappedFile::Advice::Random);
+    viewport()->update();
+    emit indexingFinished(static_cast<qint64>(m_index.lineCount()));
+  }
+}
+
+int LargeFileView::visibleLineCount() const { return qMax(1, viewport()->height() / qMax(1, fontMetrics().height())); }
+
+int LargeFileView::gutterWidth() const
+{
+  int digits = 1;
+  for (size_t max = m_index.lineCount(); max >= 10; max /= 10) ++digits;
+  return 16 + fontMetrics().horizontalAdvance(QLatin1Char('9')) * digits;
+}
+
+void LargeFileView::updateScrollRanges()
+{
+  // Line counts are estimates until the index is complete; the range settles as it grows
+  const size_t lines     = m_index.lineCount();
+  const size_t pageLines = static_cast<size_t>(visibleLineCount());
+  const size_t lastFirst = lines > pageLines ? lines - pageLines : 0;
+  verticalScrollBar()->setRange(0, static_cast<int>(std::min<size_t>(lastFirst, INT_MAX)));
+  verticalScrollBar()->setPageStep(static_cast<int>(pageLines));
+
+  const int textWidth = viewport()->width() - gutterWidth();
+  horizontalScrollBar()->setRange(0, qMax(0, m_widestLine - textWidth));
+  horizontalScrollBar()->setPageStep(qMax(1, textWidth));
+  horizontalScrollBar()->setSingleStep(fontMetrics().horizontalAdvance(QLatin1Char('9')));
+}
+
+void LargeFileView::resizeEvent(QResizeEvent *event)
+{
+  QAbstractScrollArea::resizeEvent(event);
+  updateScrollRanges();
+}
+
+void LargeFileView::paintEvent(QPaintEvent *event)
+{
+  QPainter painter(viewport());
+  const auto &colors     = CodeWizard::Theme::ThemeEngine::instance().colors();
+  const QFontMetrics &fm = fontMetrics();
+  const int lineHeight   = fm.height();
+  const int gutter       = gutterWidth();
+  const int xOffset      = horizontalScrollBar()->value();
+
+  painter.fillRect(event->rect(), colors.editorBackground);
+  painter.fillRect(QRect(0, 0, gutter, viewport()->height()), colors.lineNumberBackground);
+
+  // Decode just the visible lines, straight from the mapping. Lines the
+  // index has not reached yet are painted from an estimated position,
+  // without line numbers, rather than scanning up to them here. A line
+  // longer than a row is only read a row at a time: its rest goes on
+  // continuation rows without a number.
+  const size_t first = static_cast<size_t>(verticalScrollBar()->value());
+  const bool exact   = m_index.isLineIndexed(first);
+  const int rows     = visibleLineCount() + 1;
+  size_t start       = exact ? m_index.lineStart(first) : m_index.estimatedLineStart(first);
+  size_t line        = first;
+  int widest         = m_widestLine;
+  QStringDecoder decoder(m_encoding);
+  for (int row = 0; row < rows && start != LineIndex::npos; ++row) {
+    const int top               = row * lineHeight;
+    const bool continuation     = !m_index.isLineStart(start);
+    const size_t next           = m_index.nextLineStart(start, kMaxPaintedBytes);
+    const std::string_view text = m_index.lineAt(start, kMaxPaintedBytes);
+
+    if (!continuation) {
+      painter.setClipping(false);
+      painter.setPen(colors.lineNumberForeground);
+      const QString number = exact ? QString::number(line + 1) : QStringLiteral("~");
+      painter.drawText(0, top, gutter - 8, lineHeight, Qt::AlignRight, number);
+      decoder.resetState();// Each line on its own; a continuation row picks up a split character
+    }
+    const QString decoded = decoder.decode(QByteArrayView(text.data(), static_cast<qsizetype>(text.size())));
+    painter.setClipRect(gutter, 0, viewport()->width() - gutter, viewport()->height());
+    painter.setPen(colors.editorForeground);
+    painter.drawText(gutter + 4 - xOffset, top + fm.ascent(), decoded);
+    widest = qMax(widest, fm.horizontalAdvance(decoded) + 8);
+
+    if (next != LineIndex::npos && m_index.isLineStart(next)) ++line;
+    start = next;
+  }
+
+  if (widest != m_widestLine) {
+    m_widestLine = widest;
+    updateScrollRanges();
+  }
+}
+
+void LargeFileView::keyPressEvent(QKeyEvent *event)
+{
+  QScrollBar *vertical   = verticalScrollBar();
+  QScrollBar *horizontal = horizontalScrollBar();
+  const bool control     = event->modifiers() & Qt::ControlModifier;
+  switch (event->key()) {
+  case Qt::Key_Up:
+    vertical->triggerAction(QAbstractSlider::SliderSingleStepSub);
+    break;
+  case Qt::Key_Down:
+    vertical->triggerAction(QAbstractSlider::SliderSingleStepAdd);
+    break;
+  case Qt::Key_PageUp:
+    vertical->triggerAction(QAbstractSlider::SliderPageStepSub);
+    break;
+  case Qt::Key_PageDown:
+    vertical->triggerAction(QAbstractSlider::SliderPageStepAdd);
+    break;
+  case Qt::Key_Left:
+    horizontal->triggerAction(QAbstractSlider::SliderSingleStepSub);
+    break;
+  case Qt::Key_Right:
+    horizontal->triggerAction(QAbstractSlider::SliderSingleStepAdd);
+    break;
+  case Qt::Key_Home:
+    (control ? vertical : horizontal)->triggerAction(QAbstractSlider::SliderToMinimum);
+    break;
+  case Qt::Key_End:
+    if (!control) {
+      horizontal->triggerAction(QAbstractSlider::SliderToMaximum);
+      break;
+    }
+    // The line count is an estimate until the index is complete: stay at the end as it settles
+    gotoLine(SIZE_MAX);
+    break;
+  default:
+    QAbstractScrollArea::keyPressEvent(event);
+    return;
+  }
+  event->accept();
+}
+
+}// namespace CodeWizard::Editor
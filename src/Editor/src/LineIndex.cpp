@@ -0,0 +1,139 @@
+#include "Editor/LineIndex.h"
+#include <algorithm>
+#include <cstring>
+
+namespace CodeWizard::Editor {
+
+namespace {
+  constexpr size_t kMaxBackScan = 64 * 1024;// Estimated lookups never read further back
+}// namespace
+
+LineIndex::LineIndex(std::string_view text, CodeUnit unit) : m_text(text), m_unit(unit) { m_checkpoints.push_back(0); }
+
+bool LineIndex::isLineFeedAt(size_t pos) const
+{
+  switch (m_unit) {
+  case CodeUnit::Utf16LE:
+    return pos + 1 < m_text.size() && m_text[pos] == '\n' && m_text[pos + 1] == '\0';
+  case CodeUnit::Utf16BE:
+    return pos + 1 < m_text.size() && m_text[pos] == '\0' && m_text[pos + 1] == '\n';
+  case CodeUnit::Byte:
+    break;
+  }
+  return m_text[pos] == '\n';
+}
+
+size_t LineIndex::findLineFeed(size_t from, size_t end) const
+{
+  // memchr finds the 0x0A byte; in UTF-16 it must also be the low byte of a whole code unit
+  const char *base = m_text.data();
+  while (from < end) {
+    const void *found = std::memchr(base + from, '\n', end - from);
+    if (!found) return npos;
+    const size_t at = static_cast<size_t>(static_cast<const char *>(found) - base);
+    switch (m_unit) {
+    case CodeUnit::Byte:
+      return at;
+    case CodeUnit::Utf16LE:
+      if (at % 2 == 0 && isLineFeedAt(at)) return at;
+      break;
+    case CodeUnit::Utf16BE:
+      if (at % 2 == 1 && isLineFeedAt(at - 1)) return at - 1;
+      break;
+    }
+    from = at + 1;
+  }
+  return npos;
+}
+
+bool LineIndex::buildSome(size_t maxBytes)
+{
+  const size_t end = m_text.size() - m_scanned > maxBytes ? m_scanned + maxBytes : m_text.size();
+  size_t pos       = m_scanned;
+  while (pos < end) {
+    const size_t found = findLineFeed(pos, end);
+    if (found == npos) break;
+    pos = found + unitSize();
+    if (++m_lineFeeds % kStride == 0) m_checkpoints.push_back(pos);
+  }
+  // A UTF-16 line feed may straddle `end`: its second byte is never a 0x0A, so it is not seen twice
+  m_scanned = end;
+  return isComplete();
+}
+
+size_t LineIndex::lineCount() const
+{
+  if (isComplete() || m_lineFeeds == 0) return m_lineFeeds + 1;
+  // Extrapolate from the average line length of the indexed part
+  const double average = static_cast<double>(m_scanned) / static_cast<double>(m_lineFeeds);
+  return m_lineFeeds + 1 + static_cast<size_t>(static_cast<double>(m_text.size() - m_scanned) / average);
+}
+
+size_t LineIndex::lineStart(size_t line) const
+{
+  // Line `line` starts after the line-th line feed
+  if (!isLineIndexed(line)) return npos;
+
+  size_t start = m_checkpoints[line / kStride];
+  for (size_t i = line % kStride; i > 0; --i) start = nextLineStart(start);
+  return start;
+}
+
+size_t LineIndex::estimatedLineStart(size_t line) const
+{
+  if (isLineIndexed(line) || isComplete() || m_lineFeeds == 0) return lineStart(line);
+
+  const double average = static_cast<double>(m_scanned) / static_cast<double>(m_lineFeeds);
+  const double ahead   = static_cast<double>(line - m_lineFeeds) * average;
+  size_t offset        = m_text.size();
+  if (ahead < static_cast<double>(m_text.size() - m_scanned)) offset = m_scanned + static_cast<size_t>(ahead);
+  const size_t unit = unitSize();
+  offset -= offset % unit;
+
+  // Back to the start of the line there; a huge line is cut into pieces
+  const size_t limit = offset - std::min(offset - std::min(offset, m_scanned), kMaxBackScan);
+  while (offset >= limit + unit && !isLineFeedAt(offset - unit)) offset -= unit;
+  return offset;
+}
+
+std::string_view LineIndex::lineAt(size_t start, size_t maxBytes) const
+{
+  if (start >= m_text.size()) return {};
+  const size_t unit = unitSize();
+  const size_t next = nextLineStart(start, maxBytes);
+  if (next != npos && !isLineStart(next)) return m_text.substr(start, next - start);// Cut off
+
+  size_t end = next == npos ? m_text.size() : next - unit;
+  // A carriage return before the line feed is part of the line break
+  if (end >= start + unit) {
+    const size_t last = end - unit;
+    const bool cr     = m_unit == CodeUnit::Byte    ? m_text[last] == '\r'
+                        : m_unit == CodeUnit::Utf16LE ? m_text[last] == '\r' && m_text[last + 1] == '\0'
+                                                      : m_text[last] == '\0' && m_text[last + 1] == '\r';
+    if (cr) end = last;
+  }
+  return m_text.substr(start, end - start);
+}
+
+size_t LineIndex::nextLineStart(size_t start, size_t maxBytes) const
+{
+  if (start >= m_text.size()) return npos;
+  const size_t unit = unitSize();
+  size_t limit      = std::min(maxBytes, m_text.size() - start);
+  limit             = std::max(limit - limit % unit, unit);
+
+  // One code unit past the limit: a line feed right there still ends this line
+  const size_t end   = start + std::min(m_text.size() - start, limit + unit);
+  const size_t found = findLineFeed(start, end);
+  if (found != npos) return found + unit;
+  return start + limit < m_text.size() ? start + limit : npos;
+}
+
+bool LineIndex::isLineStart(size_t offset) const
+{
+  const size_t unit = unitSize();
+  if (offset == 0) return true;
+  return offset >= unit && offset <= m_text.size() && isLineFeedAt(offset - unit);
+}
+
+}// namespace CodeWizard::Editor
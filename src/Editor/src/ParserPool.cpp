@@ -0,0 +1,122 @@
+#include "Editor/ParserPool.h"
+
+namespace CodeWizard::Editor {
+
+ParserPool &ParserPool::instance()
+{
+  static ParserPool instance;
+  return instance;
+}
+
+ParserPool::~ParserPool() { trim(); }
+
+ParserLease ParserPool::acquireParser(const TSLanguage *language)
+{
+  if (!language) return {};
+  {
+    std::lock_guard lock(m_mutex);
+    LanguageParsers &parsers = m_parsers[language];
+    if (!parsers.idle.empty()) {
+      TSParser *parser = parsers.idle.back();
+      parsers.idle.pop_back();
+      ++parsers.inUse;
+      return { this, parser, language };
+    }
+  }
+
+  // Creating a parser is cheap, but not worth holding the lock for
+  TSParser *parser = ts_parser_new();
+  if (!ts_parser_set_language(parser, language)) {
+    ts_parser_delete(parser);
+    return {};
+  }
+  std::lock_guard lock(m_mutex);
+  ++m_parsers[language].inUse;
+  return { this, parser, language };
+}
+
+CursorLease ParserPool::acquireCursor()
+{
+  {
+    std::lock_guard lock(m_mutex);
+    ++m_cursorsInUse;
+    if (!m_idleCursors.empty()) {
+      TSQueryCursor *cursor = m_idleCursors.back();
+      m_idleCursors.pop_back();
+      return { this, cursor, nullptr };
+    }
+  }
+  return { this, ts_query_cursor_new(), nullptr };
+}
+
+void ParserPool::release(TSParser *parser, const void *language)
+{
+  // Whatever the last borrower set up must not leak into the next parse
+  ts_parser_reset(parser);
+  ts_parser_set_cancellation_flag(parser, nullptr);
+  ts_parser_set_timeout_micros(parser, 0);
+  ts_parser_set_included_ranges(parser, nullptr, 0);
+
+  {
+    std::lock_guard lock(m_mutex);
+    LanguageParsers &parsers = m_parsers[static_cast<const TSLanguage *>(language)];
+    --parsers.inUse;
+    if (parsers.idle.size() < m_maxIdleParsers) {
+      parsers.idle.push_back(parser);
+      return;
+    }
+  }
+  ts_parser_delete(parser);
+}
+
+void ParserPool::release(TSQueryCursor *cursor, const void *)
+{
+  {
+    std::lock_guard lock(m_mutex);
+    --m_cursorsInUse;
+    if (m_idleCursors.size() < m_maxIdleCursors) {
+      m_idleCursors.push_back(cursor);
+      return;
+    }
+  }
+  ts_query_cursor_delete(cursor);
+}
+
+ParserPoolStatistics ParserPool::statistics() const
+{
+  std::lock_guard lock(m_mutex);
+  ParserPoolStatistics stats;
+  for (const auto &[language, parsers] : m_parsers) {
+    stats.parsersInUse += parsers.inUse;
+    stats.parsersIdle += parsers.idle.size();
+    if (parsers.inUse || !parsers.idle.empty()) ++stats.languages;
+  }
+  stats.cursorsInUse = m_cursorsInUse;
+  stats.cursorsIdle  = m_idleCursors.size();
+  return stats;
+}
+
+void ParserPool::setMaxIdle(size_t parsersPerLanguage, size_t cursors)
+{
+  std::lock_guard lock(m_mutex);
+  m_maxIdleParsers = parsersPerLanguage;
+  m_maxIdleCursors = cursors;
+}
+
+void ParserPool::trim()
+{
+  std::vector<TSParser *> parsers;
+  std::vector<TSQueryCursor *> cursors;
+  {
+    std::lock_guard lock(m_mutex);
+    for (auto &[language, entry] : m_parsers) {
+      parsers.insert(parsers.end(), entry.idle.begin(), entry.idle.end());
+      entry.idle.clear();
+    }
+    cursors.swap(m_idleCursors);
+  }
+  for (TSParser *parser : parsers) ts_parser_delete(parser);
+  for (TSQueryCursor *cursor : cursors) ts_query_cursor_delete(cursor);
+}
+
+}// namespace CodeWizard::Editor
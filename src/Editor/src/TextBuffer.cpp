@@ -0,0 +1,535 @@
+#include "Editor/TextBuffer.h"
+#include <algorithm>
+#include <cstring>
+
+namespace CodeWizard::Editor {
+namespace detail {
+  // Backing storage for pieces. Bytes are written once and never move.
+  struct PieceChunk
+  {
+    std::unique_ptr<char[]> bytes;
+    size_t capacity = 0;
+    bool indexed    = false;
+    // Offsets of every '\n' in the chunk (indexed chunks only)
+    std::vector<size_t> lineFeeds;
+    // UTF-16 units in front of every kUtf16CheckpointBytes boundary (indexed chunks only)
+    std::vector<size_t> utf16Checkpoints;
+  };
+
+  struct PieceNode
+  {
+    const PieceChunk *chunk = nullptr;
+    size_t start            = 0;
+    size_t length           = 0;
+    size_t lineFeeds        = 0;
+    size_t utf16Length      = 0;
+    uint32_t priority       = 0;
+
+    // Subtree aggregates
+    size_t totalLength    = 0;
+    size_t totalLineFeeds = 0;
+    size_t totalUtf16     = 0;
+
+    std::shared_ptr<const PieceNode> left;
+    std::shared_ptr<const PieceNode> right;
+  };
+}// namespace detail
+
+namespace {
+  using detail::PieceChunk;
+  using detail::PieceNode;
+  using NodePtr = std::shared_ptr<const PieceNode>;
+
+  // Inserts up to this size are appended to the shared arena chunk;
+  // larger ones get their own line-indexed chunk.
+  constexpr size_t kArenaInsertLimit = 4 * 1024;
+  constexpr size_t kArenaCapacity    = 64 * 1024;
+  // Spacing of the UTF-16 checkpoints in indexed chunks; bounds the
+  // bytes decoded per offset conversion.
+  constexpr size_t kUtf16CheckpointBytes = 4 * 1024;
+
+  size_t totalLength(const NodePtr &node) { return node ? node->totalLength : 0; }
+  size_t totalLineFeeds(const NodePtr &node) { return node ? node->totalLineFeeds : 0; }
+  size_t totalUtf16(const NodePtr &node) { return node ? node->totalUtf16 : 0; }
+
+  size_t nodeCount(const NodePtr &node) { return node ? 1 + nodeCount(node->left) + nodeCount(node->right) : 0; }
+
+  const char *pieceData(const PieceNode &node) { return node.chunk->bytes.get() + node.start; }
+
+  // Number of '\n' in the first `length` bytes of a piece
+  size_t countLineFeeds(const PieceChunk &chunk, size_t start, size_t length)
+  {
+    if (chunk.indexed) {
+      auto first = std::lower_bound(chunk.lineFeeds.begin(), chunk.lineFeeds.end(), start);
+      auto last  = std::lower_bound(first, chunk.lineFeeds.end(), start + length);
+      return static_cast<size_t>(last - first);
+    }
+    const char *data = chunk.bytes.get() + start;
+    return static_cast<size_t>(std::count(data, data + length, '\n'));
+  }
+
+  // Offset inside the piece of its n-th (1-based) '\n'
+  size_t nthLineFeed(const PieceNode &node, size_t n)
+  {
+    const PieceChunk &chunk = *node.chunk;
+    if (chunk.indexed) {
+      auto first = std::lower_bound(chunk.lineFeeds.begin(), chunk.lineFeeds.end(), node.start);
+      return *(first + static_cast<std::ptrdiff_t>(n - 1)) - node.start;
+    }
+    const char *data = pieceData(node);
+    const char *end  = data + node.length;
+    for (const char *p = data; p < end; ++p) {
+      p = static_cast<const char *>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+      if (!p) break;
+      if (--n == 0) return static_cast<size_t>(p - data);
+    }
+    return node.length;
+  }
+
+  // UTF-16 code units encoded by a run of UTF-8 bytes. Every lead byte
+  // yields one unit and 4-byte sequences one more (surrogate pair), so
+  // the count is additive over any split of the run.
+  size_t utf16Units(const char *data, size_t length)
+  {
+    size_t units = 0;
+    for (size_t i = 0; i < length; ++i) {
+      const auto byte = static_cast<unsigned char>(data[i]);
+      units += ((byte & 0xC0) != 0x80) + (byte >= 0xF0);
+    }
+    return units;
+  }
+
+  // Bytes to skip from data so that `units` UTF-16 units are consumed.
+  // Offsets inside a surrogate pair round up to the next character.
+  size_t advanceUtf16(const char *data, size_t length, size_t units)
+  {
+    size_t consumed = 0;
+    for (size_t i = 0; i < length; ++i) {
+      const auto byte = static_cast<unsigned char>(data[i]);
+      if ((byte & 0xC0) == 0x80) continue;
+      if (consumed >= units) return i;
+      consumed += byte >= 0xF0 ? 2 : 1;
+    }
+    return length;
+  }
+
+  // UTF-16 units in bytes [0, offset) of an indexed chunk
+  size_t chunkUtf16Prefix(const PieceChunk &chunk, size_t offset)
+  {
+    const size_t checkpoint = offset / kUtf16CheckpointBytes;
+    const size_t base       = checkpoint * kUtf16CheckpointBytes;
+    return chunk.utf16Checkpoints[checkpoint] + utf16Units(chunk.bytes.get() + base, offset - base);
+  }
+
+  size_t pieceUtf16(const PieceChunk &chunk, size_t start, size_t length)
+  {
+    if (chunk.indexed) return chunkUtf16Prefix(chunk, start + length) - chunkUtf16Prefix(chunk, start);
+    return utf16Units(chunk.bytes.get() + start, length);
+  }
+
+  // Byte offset inside the piece after `units` UTF-16 units
+  size_t pieceOffsetForUtf16(const PieceNode &node, size_t units)
+  {
+    const PieceChunk &chunk = *node.chunk;
+    if (!chunk.indexed) return advanceUtf16(pieceData(node), node.length, units);
+
+    // Jump to the last checkpoint in front of the target, then decode at most one checkpoint span
+    const size_t target = chunkUtf16Prefix(chunk, node.start) + units;
+    auto it = std::upper_bound(chunk.utf16Checkpoints.begin(), chunk.utf16Checkpoints.end(), target);
+    const size_t checkpoint = static_cast<size_t>(it - chunk.utf16Checkpoints.begin()) - 1;
+
+    size_t from     = checkpoint * kUtf16CheckpointBytes;
+    size_t consumed = chunk.utf16Checkpoints[checkpoint];
+    if (from < node.start) {
+      from     = node.start;
+      consumed = target - units;
+    }
+    const size_t end = node.start + node.length;
+    return from + advanceUtf16(chunk.bytes.get() + from, end - from, target - consumed) - node.start;
+  }
+
+  NodePtr withChildren(const PieceNode &piece, NodePtr left, NodePtr right)
+  {
+    auto node            = std::make_shared<PieceNode>();
+    node->chunk          = piece.chunk;
+    node->start          = piece.start;
+    node->length         = piece.length;
+    node->lineFeeds      = piece.lineFeeds;
+    node->utf16Length    = piece.utf16Length;
+    node->priority       = piece.priority;
+    node->totalLength    = totalLength(left) + piece.length + totalLength(right);
+    node->totalLineFeeds = totalLineFeeds(left) + piece.lineFeeds + totalLineFeeds(right);
+    node->totalUtf16     = totalUtf16(left) + piece.utf16Length + totalUtf16(right);
+    node->left           = std::move(left);
+    node->right          = std::move(right);
+    return node;
+  }
+
+  // Splits the tree so that the first part holds exactly `offset` bytes.
+  // A piece straddling the split point is cut in two.
+  std::pair<NodePtr, NodePtr> split(const NodePtr &node, size_t offset)
+  {
+    if (!node) return {};
+
+    const size_t leftLength = totalLength(node->left);
+    if (offset <= leftLength) {
+      auto [a, b] = split(node->left, offset);
+      return { std::move(a), withChildren(*node, std::move(b), node->right) };
+    }
+    if (offset >= leftLength + node->length) {
+      auto [a, b] = split(node->right, offset - leftLength - node->length);
+      return { withChildren(*node, node->left, std::move(a)), std::move(b) };
+    }
+
+    const size_t cut = offset - leftLength;
+    PieceNode head   = *node;
+    head.length      = cut;
+    head.lineFeeds   = countLineFeeds(*node->chunk, node->start, cut);
+    head.utf16Length = pieceUtf16(*node->chunk, node->start, cut);
+
+    PieceNode tail   = *node;
+    tail.start       = node->start + cut;
+    tail.length      = node->length - cut;
+    tail.lineFeeds   = node->lineFeeds - head.lineFeeds;
+    tail.utf16Length = node->utf16Length - head.utf16Length;
+
+    return { withChildren(head, node->left, nullptr), withChildren(tail, nullptr, node->right) };
+  }
+
+  NodePtr merge(const NodePtr &left, const NodePtr &right)
+  {
+    if (!left) return right;
+    if (!right) return left;
+    if (left->priority > right->priority) { return withChildren(*left, left->left, merge(left->right, right)); }
+    return withChildren(*right, merge(left, right->left), right->right);
+  }
+
+  void appendTo(const NodePtr &node, std::string &out)
+  {
+    if (!node) return;
+    appendTo(node->left, out);
+    out.append(pieceData(*node), node->length);
+    appendTo(node->right, out);
+  }
+
+  std::shared_ptr<PieceChunk> makeIndexedChunk(std::string_view text)
+  {
+    auto chunk      = std::make_shared<PieceChunk>();
+    chunk->bytes    = std::make_unique<char[]>(text.size());
+    chunk->capacity = text.size();
+    chunk->indexed  = true;
+    std::memcpy(chunk->bytes.get(), text.data(), text.size());
+
+    // memchr is vectorized by the C library (SSE2/AVX2), far ahead of a byte loop
+    const char *data = text.data();
+    const char *end  = data + text.size();
+    chunk->lineFeeds.reserve(text.size() / 32);
+    for (const char *p = data; p < end; ++p) {
+      p = static_cast<const char *>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+      if (!p) break;
+      chunk->lineFeeds.push_back(static_cast<size_t>(p - data));
+    }
+
+    chunk->utf16Checkpoints.reserve(text.size() / kUtf16CheckpointBytes + 1);
+    size_t units = 0;
+    for (size_t base = 0; base <= text.size(); base += kUtf16CheckpointBytes) {
+      chunk->utf16Checkpoints.push_back(units);
+      units += utf16Units(text.data() + base, std::min(kUtf16CheckpointBytes, text.size() - base));
+    }
+    return chunk;
+  }
+}// namespace
+
+TextBuffer::TextBuffer() = default;
+
+TextBuffer::TextBuffer(std::string_view text) { setText(text); }
+
+TextBuffer::TextBuffer(const TextBuffer &other) : m_root(other.m_root), m_chunks(other.m_chunks), m_seed(other.m_seed)
+{}
+
+TextBuffer &TextBuffer::operator=(const TextBuffer &other)
+{
+  if (this != &other) {
+    m_root      = other.m_root;
+    m_chunks    = other.m_chunks;
+    m_arena     = nullptr;
+    m_arenaUsed = 0;
+    m_seed      = other.m_seed;
+  }
+  return *this;
+}
+
+TextBuffer::TextBuffer(TextBuffer &&other) noexcept
+  : m_root(std::move(other.m_root)), m_chunks(std::move(other.m_chunks)), m_arena(other.m_arena),
+    m_arenaUsed(other.m_arenaUsed), m_seed(other.m_seed)
+{
+  other.m_arena     = nullptr;
+  other.m_arenaUsed = 0;
+}
+
+TextBuffer &TextBuffer::operator=(TextBuffer &&other) noexcept
+{
+  if (this != &other) {
+    m_root            = std::move(other.m_root);
+    m_chunks          = std::move(other.m_chunks);
+    m_arena           = other.m_arena;
+    m_arenaUsed       = other.m_arenaUsed;
+    m_seed            = other.m_seed;
+    other.m_arena     = nullptr;
+    other.m_arenaUsed = 0;
+  }
+  return *this;
+}
+
+TextBuffer::~TextBuffer() = default;
+
+uint32_t TextBuffer::nextPriority()
+{
+  // xorshift32 - only needs to be cheap and well spread
+  m_seed ^= m_seed << 13;
+  m_seed ^= m_seed >> 17;
+  m_seed ^= m_seed << 5;
+  return m_seed;
+}
+
+TextBuffer::NodePtr TextBuffer::makeNode(std::string_view text)
+{
+  PieceNode piece;
+  piece.priority = nextPriority();
+  piece.length   = text.size();
+
+  if (text.size() > kArenaInsertLimit) {
+    auto chunk        = makeIndexedChunk(text);
+    piece.chunk       = chunk.get();
+    piece.lineFeeds   = chunk->lineFeeds.size();
+    piece.utf16Length = pieceUtf16(*chunk, 0, text.size());
+    m_chunks.push_back(std::move(chunk));
+    return withChildren(piece, nullptr, nullptr);
+  }
+
+  if (!m_arena || m_arena->capacity - m_arenaUsed < text.size()) {
+    auto chunk      = std::make_shared<PieceChunk>();
+    chunk->bytes    = std::make_unique<char[]>(kArenaCapacity);
+    chunk->capacity = kArenaCapacity;
+    m_arena         = chunk.get();
+    m_arenaUsed     = 0;
+    m_chunks.push_back(std::move(chunk));
+  }
+
+  std::memcpy(m_arena->bytes.get() + m_arenaUsed, text.data(), text.size());
+  piece.chunk     = m_arena;
+  piece.start     = m_arenaUsed;
+  piece.lineFeeds   = countLineFeeds(*m_arena, m_arenaUsed, text.size());
+  piece.utf16Length = utf16Units(text.data(), text.size());
+  m_arenaUsed += text.size();
+  return withChildren(piece, nullptr, nullptr);
+}
+
+void TextBuffer::setText(std::string_view text)
+{
+  m_root.reset();
+  m_chunks.clear();
+  m_arena     = nullptr;
+  m_arenaUsed = 0;
+  if (text.empty()) return;
+
+  PieceNode piece;
+  auto chunk        = makeIndexedChunk(text);
+  piece.chunk       = chunk.get();
+  piece.length      = text.size();
+  piece.lineFeeds   = chunk->lineFeeds.size();
+  piece.utf16Length = pieceUtf16(*chunk, 0, text.size());
+  piece.priority    = nextPriority();
+  m_chunks.push_back(std::move(chunk));
+  m_root = withChildren(piece, nullptr, nullptr);
+}
+
+void TextBuffer::insert(size_t offset, std::string_view text)
+{
+  if (text.empty()) return;
+  offset = std::min(offset, length());
+
+  NodePtr node = makeNode(text);
+  auto [left, right] = split(m_root, offset);
+  m_root = merge(merge(left, node), right);
+}
+
+void TextBuffer::remove(size_t offset, size_t length)
+{
+  const size_t size = this->length();
+  if (offset >= size || length == 0) return;
+  length = std::min(length, size - offset);
+
+  auto [left, rest] = split(m_root, offset);
+  auto [removed, right] = split(rest, length);
+  m_root = merge(left, right);
+}
+
+size_t TextBuffer::length() const { return totalLength(m_root); }
+
+size_t TextBuffer::utf16Length() const { return totalUtf16(m_root); }
+
+uint32_t TextBuffer::lineCount() const { return static_cast<uint32_t>(totalLineFeeds(m_root) + 1); }
+
+size_t TextBuffer::memoryUsage() const
+{
+  size_t bytes = m_chunks.capacity() * sizeof(m_chunks.front());
+  for (const auto &chunk : m_chunks) {
+    bytes += sizeof(PieceChunk) + chunk->capacity;
+    bytes += (chunk->lineFeeds.capacity() + chunk->utf16Checkpoints.capacity()) * sizeof(size_t);
+  }
+  // Nodes live in make_shared blocks: the node plus a small control block
+  bytes += nodeCount(m_root) * (sizeof(PieceNode) + 2 * sizeof(void *));
+  return bytes;
+}
+
+std::string TextBuffer::text() const
+{
+  std::string out;
+  out.reserve(length());
+  appendTo(m_root, out);
+  return out;
+}
+
+std::string TextBuffer::substr(size_t offset, size_t length) const
+{
+  std::string out;
+  if (offset >= this->length()) return out;
+  length = std::min(length, this->length() - offset);
+  out.reserve(length);
+  forEachChunk(offset, length, [&out](std::string_view chunk) { out.append(chunk); });
+  return out;
+}
+
+std::string TextBuffer::line(uint32_t line) const { return substr(lineStart(line), lineLength(line)); }
+
+std::string_view TextBuffer::chunkAt(size_t offset) const
+{
+  const PieceNode *node = m_root.get();
+  while (node) {
+    const size_t leftLength = totalLength(node->left);
+    if (offset < leftLength) {
+      node = node->left.get();
+      continue;
+    }
+    offset -= leftLength;
+    if (offset < node->length) { return { pieceData(*node) + offset, node->length - offset }; }
+    offset -= node->length;
+    node = node->right.get();
+  }
+  return {};
+}
+
+size_t TextBuffer::lineStart(uint32_t line) const
+{
+  if (line == 0) return 0;
+  if (line >= lineCount()) return length();
+
+  // Find the line-th '\n'; the line starts right after it
+  size_t remaining      = line;
+  size_t offset         = 0;
+  const PieceNode *node = m_root.get();
+  while (node) {
+    const size_t leftLineFeeds = totalLineFeeds(node->left);
+    if (remaining <= leftLineFeeds) {
+      node = node->left.get();
+      continue;
+    }
+    remaining -= leftLineFeeds;
+    offset += totalLength(node->left);
+    if (remaining <= node->lineFeeds) { return offset + nthLineFeed(*node, remaining) + 1; }
+    remaining -= node->lineFeeds;
+    offset += node->length;
+    node = node->right.get();
+  }
+  return length();
+}
+
+size_t TextBuffer::lineLength(uint32_t line) const
+{
+  if (line >= lineCount()) return 0;
+  const size_t start = lineStart(line);
+  const size_t end   = (line + 1 < lineCount()) ? lineStart(line + 1) - 1 : length();
+  return end - start;
+}
+
+Core::Position TextBuffer::positionFromOffset(size_t offset) const
+{
+  offset = std::min(offset, length());
+
+  // Count the line feeds in front of offset
+  size_t lineFeeds      = 0;
+  size_t remaining      = offset;
+  const PieceNode *node = m_root.get();
+  while (node) {
+    const size_t leftLength = totalLength(node->left);
+    if (remaining <= leftLength) {
+      node = node->left.get();
+      continue;
+    }
+    lineFeeds += totalLineFeeds(node->left);
+    remaining -= leftLength;
+    if (remaining <= node->length) {
+      lineFeeds += countLineFeeds(*node->chunk, node->start, remaining);
+      break;
+    }
+    lineFeeds += node->lineFeeds;
+    remaining -= node->length;
+    node = node->right.get();
+  }
+
+  const auto line = static_cast<uint32_t>(lineFeeds);
+  return { line, static_cast<uint32_t>(offset - lineStart(line)) };
+}
+
+size_t TextBuffer::offsetFromPosition(Core::Position position) const
+{
+  if (position.line >= lineCount()) return length();
+  return lineStart(position.line) + std::min<size_t>(position.character, lineLength(position.line));
+}
+
+size_t TextBuffer::offsetFromUtf16(size_t units) const
+{
+  units = std::min(units, utf16Length());
+
+  size_t offset         = 0;
+  const PieceNode *node = m_root.get();
+  while (node) {
+    const size_t leftUnits = totalUtf16(node->left);
+    if (units < leftUnits) {
+      node = node->left.get();
+      continue;
+    }
+    units -= leftUnits;
+    offset += totalLength(node->left);
+    if (units < node->utf16Length) { return offset + pieceOffsetForUtf16(*node, units); }
+    units -= node->utf16Length;
+    offset += node->length;
+    node = node->right.get();
+  }
+  return offset;
+}
+
+size_t TextBuffer::utf16FromOffset(size_t offset) const
+{
+  offset = std::min(offset, length());
+
+  size_t units          = 0;
+  const PieceNode *node = m_root.get();
+  while (node) {
+    const size_t leftLength = totalLength(node->left);
+    if (offset <= leftLength) {
+      node = node->left.get();
+      continue;
+    }
+    units += totalUtf16(node->left);
+    offset -= leftLength;
+    if (offset <= node->length) return units + pieceUtf16(*node->chunk, node->start, offset);
+    units += node->utf16Length;
+    offset -= node->length;
+    node = node->right.get();
+  }
+  return units;
+}
+
+}// namespace CodeWizard::Editor
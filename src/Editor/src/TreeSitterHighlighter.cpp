@@ -1,31 +1,108 @@
 #include "Editor/TreeSitterHighlighter.h"
+#include "Editor/HighlightBudget.h"
+#include "Editor/HighlighterLogging.h"
+#include "Editor/ParserPool.h"
+#include <Core/ThreadPool.h>
 #include <QApplication>
 #include <QDebug>
 #include <QPalette>
 #include <QString>
 #include <QTextBlock>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iterator>
+#include <mutex>
 
 namespace CodeWizard::Editor {
 
-TreeSitterHighlighter::TreeSitterHighlighter(QTextDocument *parent) : QSyntaxHighlighter(parent)
+Q_LOGGING_CATEGORY(lcHighlighter, "codewizard.editor.highlighter", QtWarningMsg)
+
+namespace {
+  // Upper bound for a single parse; normally a newer edit cancels it much earlier
+  constexpr uint64_t kParseTimeoutMicros = 10'000'000;
+
+  // Lazy mode: blocks formatted around the viewport, and the time one idle
+  // slice may spend before yielding back to the event loop
+  constexpr int kWindowMarginBlocks = 100;
+  constexpr qint64 kBackfillSliceNs = 4'000'000;
+
+  // Lines collected by one query walk when highlightBlock finds no spans for its line
+  constexpr uint32_t kSpanSweepLines = 256;
+
+  // Rough heap cost of one syntax node; tree-sitter does not report tree sizes
+  constexpr size_t kTreeBytesPerNode = 48;
+
+  size_t treeMemoryUsage(const TSTree *tree)
+  {
+    return tree ? ts_node_descendant_count(ts_tree_root_node(tree)) * kTreeBytesPerNode : 0;
+  }
+
+  // Format generation the block was last highlighted with
+  struct HighlightBlockData : public QTextBlockUserData
+  {
+    quint64 generation = 0;
+  };
+}// namespace
+
+// Shared between the highlighter and its parse job. The job holds a reference,
+// so the cancellation flag stays valid even if the highlighter goes away
+// mid-parse; `owner` is cleared under the mutex before that happens.
+// The parser itself is borrowed from ParserPool for the duration of the job.
+struct TreeSitterHighlighter::ParseChannel
+{
+  explicit ParseChannel(TreeSitterHighlighter *highlighter) : owner(highlighter) {}
+
+  // tree-sitter polls the flag as a plain size_t; every access from our
+  // side goes through std::atomic_ref
+  void setCancelled(bool cancelled)
+  {
+    std::atomic_ref<size_t>(cancelFlag).store(cancelled ? 1 : 0, std::memory_order_relaxed);
+  }
+
+  std::mutex mutex;
+  TreeSitterHighlighter *owner = nullptr;
+  alignas(std::atomic_ref<size_t>::required_alignment) size_t cancelFlag = 0;
+  InjectionEngine injections{ cancelFlag };// Embedded languages, job side only
+};
+
+TreeSitterHighlighter::TreeSitterHighlighter(QTextDocument *parent) : QSyntaxHighlighter(static_cast<QObject *>(parent))
 {
-  m_parser        = ts_parser_new();
+  m_channel       = std::make_shared<ParseChannel>(this);
   m_debounceTimer = new QTimer(this);
   m_debounceTimer->setSingleShot(true);
   m_debounceTimer->setInterval(50);// 50ms debounce for rapid typing
 
   connect(m_debounceTimer, &QTimer::timeout, this, &TreeSitterHighlighter::processPendingChanges);
 
-  // Connect to document changes
-  connect(document(), &QTextDocument::contentsChange, this, &TreeSitterHighlighter::onDocumentContentsChanged);
+  // Polls a language whose queries are still compiling on the thread pool
+  m_languagePollTimer = new QTimer(this);
+  m_languagePollTimer->setInterval(5);
+  connect(m_languagePollTimer, &QTimer::timeout, this, &TreeSitterHighlighter::pollPendingLanguage);
+
+  // Zero-interval timer: one backfill slice per event loop pass
+  m_backfillTimer = new QTimer(this);
+  m_backfillTimer->setInterval(0);
+  connect(m_backfillTimer, &QTimer::timeout, this, &TreeSitterHighlighter::backfillSlice);
+
+  // Connect to document changes BEFORE attaching the document, so the text
+  // buffer is already updated when QSyntaxHighlighter re-formats the edited blocks
+  connect(parent, &QTextDocument::contentsChange, this, &TreeSitterHighlighter::onDocumentContentsChanged);
+  setDocument(parent);
 
   setThemeDefault();
+  HighlightBudget::instance().add(this);
 }
 
 TreeSitterHighlighter::~TreeSitterHighlighter()
 {
+  HighlightBudget::instance().remove(this);
+  {
+    std::lock_guard lock(m_channel->mutex);
+    m_channel->owner = nullptr;
+    m_channel->setCancelled(true);
+  }
   if (m_tree) ts_tree_delete(m_tree);
-  if (m_parser) ts_parser_delete(m_parser);
 }
 
 void TreeSitterHighlighter::setThemeDefault()
@@ -110,46 +187,84 @@ void TreeSitterHighlighter::setThemeDefault()
 
 void TreeSitterHighlighter::setTheme(const std::unordered_map<std::string, QTextCharFormat> &theme)
 {
-  m_theme = theme;
+  m_theme = CaptureFormats::instance().intern(theme);
   buildCaptureCache();
-  if (m_tree) rehighlight();
+  if (m_tree) rehighlightAll();
 }
 
 void TreeSitterHighlighter::buildCaptureCache()
 {
-  m_captureIndexToFormat.clear();
+  // Spans only keep captures that have a format
+  invalidateSpans();
+  m_layerFormats.clear();
+  m_captureFormats.reset();
   if (!m_languageInfo || !m_languageInfo->highlightQuery) return;
+  m_captureFormats = CaptureFormats::instance().table(m_languageInfo->highlightQuery, m_theme);
+}
 
-  uint32_t count = ts_query_capture_count(m_languageInfo->highlightQuery);
-  for (uint32_t i = 0; i < count; ++i) {
-    uint32_t len     = 0;
-    const char *name = ts_query_capture_name_for_id(m_languageInfo->highlightQuery, i, &len);
-    std::string captureName(name, len);
-
-    // Direct match
-    auto it = m_theme.find(captureName);
-    if (it != m_theme.end()) {
-      m_captureIndexToFormat[i] = it->second;
-      continue;
-    }
+// Format table of an injected language, looked up the first time one of its layers is highlighted
+uint16_t TreeSitterHighlighter::layerFormatsId(const LanguageInfo *language)
+{
+  if (m_layerFormats.empty()) m_layerFormats.emplace_back();// slot 0: the host
+  for (size_t i = 1; i < m_layerFormats.size(); ++i) {
+    if (m_layerFormats[i].first == language) return static_cast<uint16_t>(i);
+  }
+  m_layerFormats.emplace_back(language, CaptureFormats::instance().table(language->highlightQuery, m_theme));
+  return static_cast<uint16_t>(m_layerFormats.size() - 1);
+}
 
-    // Try parent categories (e.g., "function.call" -> "function")
-    size_t dotPos = captureName.find_last_of('.');
-    while (dotPos != std::string::npos) {
-      std::string parent = captureName.substr(0, dotPos);
-      it                 = m_theme.find(parent);
-      if (it != m_theme.end()) {
-        m_captureIndexToFormat[i] = it->second;
-        break;
-      }
-      dotPos = captureName.find_last_of('.', dotPos - 1);
+const QTextCharFormat *TreeSitterHighlighter::formatFor(uint16_t layer, uint32_t captureIndex) const
+{
+  const CaptureFormatTable *table = layer == 0 ? m_captureFormats.get() : m_layerFormats[layer].second.get();
+  return table ? table->at(captureIndex) : nullptr;
+}
+
+bool TreeSitterHighlighter::setLanguage(const QString &languageName)
+{
+  LanguageFuture future = TreeSitterManager::instance().loadLanguage(languageName);
+  if (!future.valid()) {
+    emit highlightError(QString("Language not available: %1").arg(languageName));
+    return false;
+  }
+
+  clearLanguage();
+  if (future.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+    return applyLanguage(languageName, future.get());
+  }
+
+  // Queries are still compiling on the thread pool: text stays plain until they are ready
+  m_pendingLanguage     = std::move(future);
+  m_pendingLanguageName = languageName;
+  m_languagePollTimer->start();
+  return true;
+}
+
+void TreeSitterHighlighter::pollPendingLanguage()
+{
+  if (m_pendingLanguage.valid()) {
+    if (m_pendingLanguage.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return;
+  } else {
+    for (const QString &name : m_pendingInjectionLanguages) {
+      const LanguageFuture future = TreeSitterManager::instance().loadLanguage(name);
+      if (future.valid() && future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return;
     }
   }
+
+  m_languagePollTimer->stop();
+  if (!m_pendingLanguage.valid()) {
+    // Injected languages finished compiling: parse again so their layers show up
+    if (m_pendingInjectionLanguages.isEmpty()) return;
+    m_pendingInjectionLanguages.clear();
+    performFullParse();
+    return;
+  }
+  LanguageFuture future = std::move(m_pendingLanguage);
+  m_pendingLanguage     = {};
+  applyLanguage(m_pendingLanguageName, future.get());
 }
 
-bool TreeSitterHighlighter::setLanguage(const QString &languageName)
+bool TreeSitterHighlighter::applyLanguage(const QString &languageName, std::shared_ptr<LanguageInfo> langInfo)
 {
-  auto langInfo = TreeSitterManager::instance().getLanguage(languageName);
   if (!langInfo || !langInfo->language) {
     emit highlightError(QString("Language not available: %1").arg(languageName));
     return false;
@@ -160,22 +275,23 @@ bool TreeSitterHighlighter::setLanguage(const QString &languageName)
     return false;
   }
 
-  clearLanguage();
-
   m_languageInfo = langInfo;
-  if (!ts_parser_set_language(m_parser, m_languageInfo->language)) {
+  m_suspended    = false;
+  // Borrowing a parser checks the grammar's ABI; it goes straight back to the pool
+  if (!ParserPool::instance().acquireParser(m_languageInfo->language)) {
     emit highlightError("Failed to set parser language");
     m_languageInfo.reset();
     return false;
   }
-  // Print all available captures in this query
-  uint32_t count = ts_query_capture_count(langInfo->highlightQuery);
-  qDebug() << "[Highlighter] Available captures for" << languageName << ":";
-  for (uint32_t i = 0; i < count; ++i) {
-    uint32_t len;
-    const char* name = ts_query_capture_name_for_id(langInfo->highlightQuery, i, &len);
-    qDebug() << "  " << i << ":" << QString::fromUtf8(name, len);
+  if (CW_HIGHLIGHT_TRACE_ENABLED(1)) {
+    const uint32_t count = ts_query_capture_count(langInfo->highlightQuery);
+    qCDebug(lcHighlighter) << "Available captures for" << languageName << ":";
+    for (uint32_t i = 0; i < count; ++i) qCDebug(lcHighlighter) << "  " << i << ":" << captureName(0, i);
   }
+
+  const QByteArray utf8 = document()->toPlainText().toUtf8();
+  m_buffer.setText(std::string_view(utf8.constData(), static_cast<size_t>(utf8.size())));
+
   buildCaptureCache();
   performFullParse();
   return true;
@@ -183,14 +299,66 @@ bool TreeSitterHighlighter::setLanguage(const QString &languageName)
 
 void TreeSitterHighlighter::clearLanguage()
 {
+  m_pendingLanguage = {};
+  m_languagePollTimer->stop();
   if (m_tree) {
     ts_tree_delete(m_tree);
     m_tree = nullptr;
   }
+  resetParser();
   m_languageInfo.reset();
-  m_lastText.clear();
-  m_lastUtf8.clear();
-  m_captureIndexToFormat.clear();
+  m_buffer.setText({});
+  m_captureFormats.reset();
+  m_layerFormats.clear();
+  m_injections.clear();
+  m_pendingInjectionLanguages.clear();
+  m_suspended   = false;
+  m_treeVersion = 0;
+  clearDirty();
+  invalidateSpans();
+  m_folding.clear();
+  emit foldsChanged();
+}
+
+size_t TreeSitterHighlighter::memoryUsage() const
+{
+  size_t bytes = m_buffer.memoryUsage() + treeMemoryUsage(m_tree);
+  for (const InjectionLayer &layer : m_injections) bytes += treeMemoryUsage(layer.tree.get());
+  bytes += m_spans.capacity() * sizeof(HighlightSpan) + m_lineSpanOffsets.capacity() * sizeof(uint32_t);
+  bytes += m_spanScratch.capacity() * sizeof(m_spanScratch.front());
+  return bytes;
+}
+
+void TreeSitterHighlighter::suspend()
+{
+  if (m_suspended || !m_languageInfo) return;
+
+  m_debounceTimer->stop();
+  m_backfillTimer->stop();
+  resetParser();// a running job's result would land on an empty buffer
+  if (m_tree) {
+    ts_tree_delete(m_tree);
+    m_tree = nullptr;
+  }
+  m_injections      = {};
+  m_buffer.setText({});
+  m_treeVersion     = 0;
+  clearDirty();
+  invalidateSpans();
+  m_spans           = {};
+  m_lineSpanOffsets = {};
+  m_spanScratch     = {};
+  m_suspended       = true;
+}
+
+void TreeSitterHighlighter::resume()
+{
+  if (!m_suspended) return;
+  m_suspended = false;
+
+  const QByteArray utf8 = document()->toPlainText().toUtf8();
+  m_buffer.setText(std::string_view(utf8.constData(), static_cast<size_t>(utf8.size())));
+  performFullParse();
 }
 
 void TreeSitterHighlighter::forceReparse()
@@ -200,268 +368,651 @@ void TreeSitterHighlighter::forceReparse()
 
 void TreeSitterHighlighter::onDocumentContentsChanged(int position, int charsRemoved, int charsAdded)
 {
-  if (!m_languageInfo || !m_tree) return;
-  // Update cached text IMMEDIATELY so highlightBlock always has valid data
-  m_lastText = document()->toPlainText();
-  m_lastUtf8 = m_lastText.toUtf8();
+  // Suspended: the buffer is rebuilt from the document on resume
+  if (!m_languageInfo || m_suspended) return;
 
-  if (!m_tree) {
-    performFullParse();
-    return;
+  // Any parse still running works on an older text: abort it
+  ++m_version;
+  if (m_parseInFlight) m_channel->setCancelled(true);
+
+  // Update the buffer IMMEDIATELY so highlightBlock always has valid data
+  const TextBuffer oldBuffer = m_buffer;// O(1) snapshot for the edit's old points
+  TSInputEdit edit           = syncBuffer(position, charsRemoved, charsAdded);
+  markDirty(edit);
+
+  // Keep the tree's byte ranges in step with the text; the reparse itself is debounced
+  invalidateSpans();
+  if (m_tree) {
+    applyEditToTree(edit, oldBuffer);
+    editInjectionLayers(m_injections, edit);
+    m_folding.edit(edit);
+    // QSyntaxHighlighter re-formats the edited lines next: collect just those
+    ensureSpans(m_buffer.positionFromOffset(edit.start_byte).line, m_buffer.positionFromOffset(edit.new_end_byte).line);
   }
-  // Debounce rapid changes (typing)
-  m_pendingEdit = { position, charsRemoved, charsAdded, true };
   m_debounceTimer->start();
 }
 
-void TreeSitterHighlighter::processPendingChanges()
+TSInputEdit TreeSitterHighlighter::syncBuffer(int position, int charsRemoved, int charsAdded)
 {
-  if (!m_pendingEdit.valid || !m_languageInfo) return;
+  // QTextDocument may over-report the changed range (e.g. by the implicit
+  // trailing paragraph separator), so clamp against what the buffer holds
+  const size_t oldLength = m_buffer.utf16Length();
+  const size_t start     = std::min<size_t>(qMax(position, 0), oldLength);
+  const size_t removed   = std::min<size_t>(qMax(charsRemoved, 0), oldLength - start);
+
+  const size_t startByte = m_buffer.offsetFromUtf16(start);
+  const size_t endByte   = m_buffer.offsetFromUtf16(start + removed);
+  m_buffer.remove(startByte, endByte - startByte);
+
+  // Only the inserted text is read back from the document
+  const int documentLength = qMax(document()->characterCount() - 1, 0);
+  const int addedLength    = qBound(0, charsAdded, documentLength - static_cast<int>(start));
+  const QByteArray added   = documentText(static_cast<int>(start), addedLength).toUtf8();
+  m_buffer.insert(startByte, std::string_view(added.constData(), static_cast<size_t>(added.size())));
+
+  if (m_buffer.utf16Length() != static_cast<size_t>(documentLength)) {
+    qCWarning(lcHighlighter) << "Text buffer out of sync, rebuilding";
+    const QByteArray utf8 = document()->toPlainText().toUtf8();
+    m_buffer.setText(std::string_view(utf8.constData(), static_cast<size_t>(utf8.size())));
+    // The edit no longer describes the change; the next parse must start from scratch
+    if (m_tree) {
+      ts_tree_delete(m_tree);
+      m_tree = nullptr;
+    }
+  }
 
-  QElapsedTimer timer;
-  timer.start();
-  emit parsingStarted();
+  TSInputEdit edit{};
+  edit.start_byte   = static_cast<uint32_t>(startByte);
+  edit.old_end_byte = static_cast<uint32_t>(endByte);
+  edit.new_end_byte = static_cast<uint32_t>(startByte + static_cast<size_t>(added.size()));
+  return edit;
+}
 
-  performIncrementalParse(m_pendingEdit.position, m_pendingEdit.charsRemoved, m_pendingEdit.charsAdded);
+// Text of [position, position + length) read from the blocks it spans
+QString TreeSitterHighlighter::documentText(int position, int length) const
+{
+  QString out;
+  out.reserve(length);
+  QTextBlock block = document()->findBlock(position);
+  while (block.isValid() && out.size() < length) {
+    const QString text = block.text();
+    out += QStringView(text).mid(qMax(position - block.position(), 0), length - out.size());
+    if (out.size() < length && block.next().isValid()) out += QLatin1Char('\n');
+    block = block.next();
+  }
+  return out;
+}
 
-  emit parsingFinished(timer.elapsed(), true);
-  m_pendingEdit.valid = false;
+void TreeSitterHighlighter::processPendingChanges()
+{
+  if (!m_languageInfo) return;
+  startParse(m_tree != nullptr);
+}
+
+void TreeSitterHighlighter::resetParser()
+{
+  // A job may still be running, or its result already queued: detach it so
+  // that result is dropped (the queued delivery checks the channel)
+  if (m_channel) {
+    std::lock_guard lock(m_channel->mutex);
+    m_channel->owner = nullptr;
+    m_channel->setCancelled(true);
+  }
+  m_channel        = std::make_shared<ParseChannel>(this);
+  m_parseInFlight  = false;
+  m_reparsePending = false;
 }
 
 void TreeSitterHighlighter::performFullParse()
 {
-  if (!m_languageInfo || m_isParsing) return;
+  if (!m_languageInfo) return;
+
+  if (m_tree) {
+    ts_tree_delete(m_tree);
+    m_tree = nullptr;
+  }
+  m_treeVersion = 0;
+  clearDirty();
+  startParse(false);
+}
+
+void TreeSitterHighlighter::startParse(bool incremental)
+{
+  if (!m_languageInfo || m_suspended) return;
+
+  // One job at a time per document: results must arrive in order. The
+  // running job was cancelled by the edit; parse again once it reports back.
+  if (m_parseInFlight) {
+    m_reparsePending = true;
+    return;
+  }
 
-  m_isParsing = true;
   ++m_stats.parseCount;
-  ++m_stats.fullParseCount;
+  if (incremental) {
+    ++m_stats.incrementalParseCount;
+  } else {
+    ++m_stats.fullParseCount;
+  }
 
-  QElapsedTimer timer;
-  timer.start();
+  m_parseInFlight  = true;
+  m_reparsePending = false;
+  m_channel->setCancelled(false);
   emit parsingStarted();
 
-  QString text    = document()->toPlainText();
-  QByteArray utf8 = text.toUtf8();
+  // The job gets its own reference to the (already edited) old tree and an
+  // O(1) snapshot of the buffer, so later edits on the UI thread cannot race with it
+  std::shared_ptr<ParseChannel> channel = m_channel;
+  TreePtr oldTree(incremental && m_tree ? ts_tree_copy(m_tree) : nullptr, ts_tree_delete);
+  TextBuffer snapshot   = m_buffer;
+  const quint64 version = m_version;
+
+  // Injection layers go along the same way: private copies of their edited trees
+  std::shared_ptr<LanguageInfo> language = m_languageInfo;
+  InjectionLayers layers;
+  if (oldTree) {
+    layers.reserve(m_injections.size());
+    for (const InjectionLayer &layer : m_injections) {
+      layers.push_back({ layer.language, layer.range, TreePtr(ts_tree_copy(layer.tree.get()), ts_tree_delete) });
+    }
+  }
+  std::vector<std::pair<size_t, size_t>> edited;
+  if (m_dirtyStart != SIZE_MAX) edited.emplace_back(m_dirtyStart, m_dirtyEnd);
+  FoldRegions folds = oldTree ? m_folding.regions() : FoldRegions{};
+
+  Core::globalThreadPool().post([channel, language, oldTree, snapshot, layers, edited, folds, version, incremental]() {
+    QElapsedTimer timer;
+    timer.start();
+
+    // Stream the pieces straight to the parser: no contiguous copy of the text
+    TSInput input{};
+    input.payload  = const_cast<TextBuffer *>(&snapshot);
+    input.encoding = TSInputEncodingUTF8;
+    input.read     = [](void *payload, uint32_t byteIndex, TSPoint, uint32_t *bytesRead) -> const char * {
+      const std::string_view chunk = static_cast<const TextBuffer *>(payload)->chunkAt(byteIndex);
+      *bytesRead                   = static_cast<uint32_t>(chunk.size());
+      return chunk.data();
+    };
+    // The pool resets the parser when it is returned, cancelled mid-way or not
+    TSTree *parsed = nullptr;
+    if (ParserLease parser = ParserPool::instance().acquireParser(language->language)) {
+      ts_parser_set_cancellation_flag(parser.get(), &channel->cancelFlag);
+      ts_parser_set_timeout_micros(parser.get(), kParseTimeoutMicros);
+      parsed = ts_parser_parse(parser.get(), oldTree.get(), input);
+    }
+    auto result  = std::make_shared<ParseResult>();
+    result->tree = TreePtr(parsed, ts_tree_delete);
+
+    // Embedded languages and folds: only where the host syntax or the text changed
+    if (parsed) {
+      std::vector<std::pair<size_t, size_t>> changed = edited;
+      if (oldTree) {
+        uint32_t rangeCount = 0;
+        TSRange *ranges     = ts_tree_get_changed_ranges(oldTree.get(), parsed, &rangeCount);
+        for (uint32_t i = 0; i < rangeCount; ++i) changed.emplace_back(ranges[i].start_byte, ranges[i].end_byte);
+        free(ranges);
+      }
+      result->folds = findFolds(*language, parsed, snapshot, folds, changed, !oldTree);
+      result->injections =
+        channel->injections.update(*language, parsed, snapshot, layers, std::move(changed), !oldTree, result->pendingLanguages);
+    }
+    const qint64 durationMs = timer.elapsed();
+
+    std::lock_guard lock(channel->mutex);
+    if (!channel->owner) return;
+    TreeSitterHighlighter *owner = channel->owner;
+    QMetaObject::invokeMethod(
+      owner,
+      [owner, channel, result, version, durationMs, incremental]() {
+        // resetParser() ran after this was queued (suspend, language change): not ours any more
+        if (owner->m_channel != channel) return;
+        owner->onParseFinished(result, version, durationMs, incremental);
+      },
+      Qt::QueuedConnection);
+  });
+}
 
-  // Delete old tree
-  if (m_tree) {
-    ts_tree_delete(m_tree);
-    m_tree = nullptr;
+void TreeSitterHighlighter::onParseFinished(std::shared_ptr<ParseResult> result,
+  quint64 version,
+  qint64 durationMs,
+  bool incremental)
+{
+  m_parseInFlight = false;
+
+  // Stale: the document changed while we were parsing. Drop the result and
+  // reparse unless the debounce timer is about to do it anyway.
+  if (version != m_version) {
+    if (m_reparsePending && !m_debounceTimer->isActive()) processPendingChanges();
+    return;
+  }
+  m_reparsePending = false;
+
+  if (!result->tree) {
+    if (incremental) {
+      emit highlightError("Incremental parse failed, falling back to full");
+      performFullParse();
+    } else {
+      emit highlightError("Full parse failed");
+      emit parsingFinished(durationMs, incremental);
+    }
+    return;
   }
 
-  // Parse new content
-  TSTree *newTree = ts_parser_parse_string(m_parser,
-    nullptr,// No old tree - full parse
-    utf8.constData(),
-    utf8.size());
+  // Take ownership of a private copy; the job's copy dies with the lambda.
+  // No edit happened since the job started (same version), so the current
+  // tree is exactly the edited old tree the job parsed against.
+  TSTree *oldTree = m_tree;
+  m_tree          = ts_tree_copy(result->tree.get());
+  m_treeVersion   = version;
+  m_stats.totalParseTimeMs += durationMs;
+  invalidateSpans();
+
+  // The job's layer trees are its own copies and nobody else holds them
+  m_injections              = std::move(result->injections);
+  m_stats.injectionLayers   = static_cast<int>(m_injections.size());
+  m_stats.injectionReparses = static_cast<int>(
+    std::count_if(m_injections.begin(), m_injections.end(), [](const InjectionLayer &layer) { return layer.reparsed; }));
+  if (!result->pendingLanguages.isEmpty() && !m_pendingLanguage.valid()) {
+    m_pendingInjectionLanguages = result->pendingLanguages;
+    m_languagePollTimer->start();
+  }
+  m_folding.adopt(std::move(result->folds));
+  emit foldsChanged();
 
-  if (newTree) {
-    m_tree     = newTree;
-    m_lastText = text;
-    m_lastUtf8 = utf8;
-    m_stats.totalParseTimeMs += timer.elapsed();
-    rehighlight();
+  if (oldTree && incremental) {
+    rehighlightChangedRanges(oldTree, m_tree);
   } else {
-    emit highlightError("Full parse failed");
+    m_stats.lastRehighlightedBlocks = document()->blockCount();
+    rehighlightAll();
   }
+  if (oldTree) ts_tree_delete(oldTree);
+  clearDirty();
+
+  // A full parse is where a document's memory jumps (open, resume, language change)
+  if (!incremental) HighlightBudget::instance().enforce();
 
-  m_isParsing = false;
-  emit parsingFinished(timer.elapsed(), false);
+  emit parsingFinished(durationMs, incremental);
 }
-void TreeSitterHighlighter::applyEditToTree(int startByte, int oldEndByte, int newEndByte)
+
+void TreeSitterHighlighter::markDirty(const TSInputEdit &edit)
 {
-  if (!m_tree) return;
+  const size_t start  = edit.start_byte;
+  const size_t oldEnd = edit.old_end_byte;
+  const size_t newEnd = edit.new_end_byte;
 
-  // Get the new document state for calculating new_end_point
-  QString newText    = document()->toPlainText();
-  QByteArray newUtf8 = newText.toUtf8();
+  if (m_dirtyStart == SIZE_MAX) {
+    m_dirtyStart = start;
+    m_dirtyEnd   = newEnd;
+    return;
+  }
 
-  // Helper to calculate TSPoint (row, column in BYTES)
-  auto calcPoint = [](int bytePos, const QByteArray &utf8) -> TSPoint {
-    TSPoint point = { 0, 0 };
-    if (bytePos <= 0) return point;
-    if (bytePos >= utf8.size()) bytePos = utf8.size();
+  // Move the existing range into the new text's coordinates, then widen it
+  if (m_dirtyEnd >= oldEnd) {
+    m_dirtyEnd = m_dirtyEnd - oldEnd + newEnd;
+  } else if (m_dirtyEnd > start) {
+    m_dirtyEnd = start;
+  }
+  m_dirtyStart = std::min(m_dirtyStart, start);
+  m_dirtyEnd = std::max(m_dirtyEnd, newEnd);
+}
 
-    const char *data = utf8.constData();
+void TreeSitterHighlighter::clearDirty()
+{
+  m_dirtyStart = SIZE_MAX;
+  m_dirtyEnd   = 0;
+}
 
-    // Count newlines to get row
-    int lineStartByte = 0;
-    for (int i = 0; i < bytePos; ++i) {
-      if (data[i] == '\n') {
-        point.row++;
-        lineStartByte = i + 1;
-      }
+void TreeSitterHighlighter::rehighlightChangedRanges(const TSTree *oldTree, const TSTree *newTree)
+{
+  // Ranges whose syntax differs between the two trees, sorted by position
+  uint32_t rangeCount = 0;
+  TSRange *ranges     = ts_tree_get_changed_ranges(oldTree, newTree, &rangeCount);
+
+  // The edited text itself may not change the tree's shape (typing inside
+  // an identifier), so its blocks are always rehighlighted as well
+  std::vector<std::pair<size_t, size_t>> dirty;
+  dirty.reserve(rangeCount + 1);
+  for (uint32_t i = 0; i < rangeCount; ++i) dirty.emplace_back(ranges[i].start_byte, ranges[i].end_byte);
+  free(ranges);
+  if (m_dirtyStart != SIZE_MAX) dirty.emplace_back(m_dirtyStart, m_dirtyEnd);
+  // Reparsed embedded regions can change colour without any change in the host tree
+  for (const InjectionLayer &layer : m_injections) {
+    if (layer.reparsed) dirty.emplace_back(layer.range.start_byte, layer.range.end_byte);
+  }
+  std::sort(dirty.begin(), dirty.end());
+
+  int blocks    = 0;
+  int lastBlock = -1;// Ranges may overlap: never format a block twice
+  for (const auto &[startByte, endByte] : dirty) {
+    const int startChar = byteOffsetToChar(static_cast<int>(startByte));
+    const int endChar   = byteOffsetToChar(static_cast<int>(endByte));
+
+    QTextBlock block = document()->findBlock(startChar);
+    if (block.isValid() && block.blockNumber() <= lastBlock) block = document()->findBlockByNumber(lastBlock + 1);
+    if (!block.isValid()) continue;
+
+    // One query walk for the whole range (lazy mode: only the part that gets formatted now)
+    int firstLine = block.blockNumber();
+    int lastLine  = qMax(firstLine, document()->findBlock(endChar).blockNumber());
+    if (m_lazy) {
+      firstLine = qMax(firstLine, m_window.front().first - kWindowMarginBlocks);
+      lastLine  = qMin(lastLine, m_window.back().second + kWindowMarginBlocks);
     }
+    if (firstLine <= lastLine) ensureSpans(static_cast<uint32_t>(firstLine), static_cast<uint32_t>(lastLine));
 
-    // Column is BYTE offset within the line (not character count)
-    point.column = static_cast<uint32_t>(bytePos - lineStartByte);
+    while (block.isValid() && block.position() <= endChar) {
+      rehighlightBlock(block);
+      lastBlock = block.blockNumber();
+      ++blocks;
+      block = block.next();
+    }
+  }
+  m_stats.lastRehighlightedBlocks = blocks;
+}
 
-    return point;
-  };
+void TreeSitterHighlighter::setLazyHighlighting(bool enabled)
+{
+  if (m_lazy == enabled) return;
+  m_lazy = enabled;
+  if (!m_lazy) m_backfillTimer->stop();
+  if (m_tree) rehighlightAll();
+}
 
-  TSInputEdit edit;
-  edit.start_byte   = static_cast<uint32_t>(startByte);
-  edit.old_end_byte = static_cast<uint32_t>(oldEndByte);
-  edit.new_end_byte = static_cast<uint32_t>(newEndByte);
+void TreeSitterHighlighter::setVisibleBlocks(int firstBlock, int lastBlock)
+{
+  setVisibleRanges({ { firstBlock, qMax(firstBlock, lastBlock) } });
+}
 
-  // Points in the OLD document
-  edit.start_point   = calcPoint(startByte, m_lastUtf8);
-  edit.old_end_point = calcPoint(oldEndByte, m_lastUtf8);
+void TreeSitterHighlighter::setVisibleRanges(std::vector<std::pair<int, int>> ranges)
+{
+  if (ranges.empty() || ranges == m_window) return;
+  m_window = std::move(ranges);
+  if (m_lazy && m_tree) {
+    formatWindow();
+    restartBackfill();
+  }
+}
 
-  // new_end_point is in the NEW document
-  edit.new_end_point = calcPoint(newEndByte, newUtf8);
+void TreeSitterHighlighter::rehighlightAll()
+{
+  if (!m_lazy) {
+    rehighlight();
+    return;
+  }
+  // Every block is stale now; format what the user sees and leave the rest to idle time
+  ++m_formatGeneration;
+  formatWindow();
+  restartBackfill();
+}
 
-  qDebug() << "[TreeSitter] Edit:"
-           << "bytes:" << startByte << "->" << oldEndByte << "->" << newEndByte << "points:" << edit.start_point.row
-           << ":" << edit.start_point.column << "->" << edit.old_end_point.row << ":" << edit.old_end_point.column
-           << "->" << edit.new_end_point.row << ":" << edit.new_end_point.column;
+bool TreeSitterHighlighter::isInWindow(int blockNumber) const
+{
+  // The margin only extends the window above its first run and below its last
+  if (blockNumber < m_window.front().first - kWindowMarginBlocks) return false;
+  if (blockNumber > m_window.back().second + kWindowMarginBlocks) return false;
+  if (blockNumber < m_window.front().first || blockNumber > m_window.back().second) return true;
+  const auto run = std::upper_bound(m_window.begin(), m_window.end(), blockNumber,
+    [](int number, const std::pair<int, int> &range) { return number < range.first; });
+  return run != m_window.begin() && blockNumber <= std::prev(run)->second;
+}
 
-  ts_tree_edit(m_tree, &edit);
+bool TreeSitterHighlighter::isFormatted(const QTextBlock &block) const
+{
+  const auto *data = static_cast<const HighlightBlockData *>(block.userData());
+  return data && data->generation == m_formatGeneration;
 }
 
-void TreeSitterHighlighter::performIncrementalParse(int position, int charsRemoved, int charsAdded)
+void TreeSitterHighlighter::formatBlock(const QTextBlock &block)
 {
-  if (!m_tree || !m_languageInfo) return;
+  m_forceFormat = true;
+  rehighlightBlock(block);
+  m_forceFormat = false;
+}
 
-  ++m_stats.parseCount;
-  ++m_stats.incrementalParseCount;
-
-  QString newText    = document()->toPlainText();
-  QByteArray newUtf8 = newText.toUtf8();
-
-  // Calculate byte offsets using OLD document state (m_lastText)
-  int startByte  = charOffsetToByte(position, m_lastText);
-  int oldEndByte = charOffsetToByte(position + charsRemoved, m_lastText);
-  int newEndByte = charOffsetToByte(position + charsAdded, newText);
-
-  // CRITICAL: Apply edit to tree BEFORE parsing
-  applyEditToTree(startByte, oldEndByte, newEndByte);// <-- CALL IT HERE
-
-  // Now parse with the edited tree as base
-  TSInput input = { &newUtf8,
-    [](void *payload, uint32_t byte_offset, TSPoint, uint32_t *bytes_read) -> const char * {
-      const QByteArray *data = static_cast<const QByteArray *>(payload);
-      if (byte_offset >= static_cast<uint32_t>(data->size())) {
-        *bytes_read = 0;
-        return nullptr;
-      }
-      *bytes_read = data->size() - byte_offset;
-      return data->constData() + byte_offset;
-    },
-    TSInputEncodingUTF8 };
+void TreeSitterHighlighter::formatWindow()
+{
+  for (size_t i = 0; i < m_window.size(); ++i) {
+    const int first = i == 0 ? qMax(0, m_window[i].first - kWindowMarginBlocks) : m_window[i].first;
+    const int last  = i + 1 == m_window.size() ? m_window[i].second + kWindowMarginBlocks : m_window[i].second;
+
+    QTextBlock block = document()->findBlockByNumber(first);
+    while (block.isValid() && block.blockNumber() <= last && isFormatted(block)) block = block.next();
+    if (!block.isValid() || block.blockNumber() > last) continue;
+
+    ensureSpans(static_cast<uint32_t>(block.blockNumber()), static_cast<uint32_t>(last));
+    while (block.isValid() && block.blockNumber() <= last) {
+      if (!isFormatted(block)) formatBlock(block);
+      block = block.next();
+    }
+  }
+}
 
-  TSTree *newTree = ts_parser_parse(m_parser, m_tree, input);
+void TreeSitterHighlighter::restartBackfill()
+{
+  // Start right below the window: that is where the user most likely scrolls next
+  m_backfillBlock   = m_window.back().second + kWindowMarginBlocks + 1;
+  m_backfillScanned = 0;
+  if (m_lazy && m_tree) m_backfillTimer->start();
+}
 
-  if (newTree) {
-    TSTree *oldTree = m_tree;
-    m_tree          = newTree;
-    ts_tree_delete(oldTree);
+void TreeSitterHighlighter::backfillSlice()
+{
+  const int blockCount = document()->blockCount();
+  if (!m_tree || m_backfillScanned >= blockCount) {
+    m_backfillTimer->stop();
+    return;
+  }
 
-    m_lastText = newText;
-    m_lastUtf8 = newUtf8;
+  QElapsedTimer timer;
+  timer.start();
 
-    rehighlight();
-  } else {
-    emit highlightError("Incremental parse failed, falling back to full");
-    performFullParse();
+  if (m_backfillBlock >= blockCount) m_backfillBlock = 0;
+  QTextBlock block = document()->findBlockByNumber(m_backfillBlock);
+  while (m_backfillScanned < blockCount && timer.nsecsElapsed() < kBackfillSliceNs) {
+    if (!block.isValid()) block = document()->firstBlock();// wrap around to the top
+    if (!isFormatted(block)) {
+      formatBlock(block);
+      ++m_stats.backfilledBlocks;
+    }
+    ++m_backfillScanned;
+    block = block.next();
   }
+  m_backfillBlock = block.isValid() ? block.blockNumber() : 0;
+}
+
+void TreeSitterHighlighter::applyEditToTree(TSInputEdit &edit, const TextBuffer &oldBuffer)
+{
+  if (!m_tree) return;
+
+  // TSPoint (row, column in BYTES) from the buffer's line index: O(log lines)
+  auto calcPoint = [](uint32_t bytePos, const TextBuffer &buffer) -> TSPoint {
+    const Core::Position position = buffer.positionFromOffset(std::min<size_t>(bytePos, buffer.length()));
+    return TSPoint{ position.line, position.character };
+  };
+
+  // Points in the OLD document
+  edit.start_point   = calcPoint(edit.start_byte, oldBuffer);
+  edit.old_end_point = calcPoint(edit.old_end_byte, oldBuffer);
+
+  // new_end_point is in the NEW document
+  edit.new_end_point = calcPoint(edit.new_end_byte, m_buffer);
+
+  CW_HIGHLIGHT_TRACE(1) << "Edit: bytes" << edit.start_byte << "->" << edit.old_end_byte << "->" << edit.new_end_byte
+                        << "points" << edit.start_point.row << ":" << edit.start_point.column << "->"
+                        << edit.old_end_point.row << ":" << edit.old_end_point.column << "->"
+                        << edit.new_end_point.row << ":" << edit.new_end_point.column;
+
+  ts_tree_edit(m_tree, &edit);
 }
 
 void TreeSitterHighlighter::highlightBlock(const QString &text)
 {
   if (!m_tree || !m_languageInfo || !m_languageInfo->highlightQuery) return;
 
+  QTextBlock block = currentBlock();
+  auto *blockData  = static_cast<HighlightBlockData *>(currentBlockUserData());
+  if (!blockData) {
+    blockData = new HighlightBlockData;
+    setCurrentBlockUserData(blockData);
+  }
+
+  // Lazy mode: blocks away from the viewport stay plain until idle time
+  // (or scrolling) gets to them
+  if (m_lazy && !m_forceFormat && !isInWindow(block.blockNumber())) {
+    blockData->generation = 0;
+    if (!m_backfillTimer->isActive()) restartBackfill();
+    return;
+  }
+  blockData->generation = m_formatGeneration;
+
   ++m_stats.highlightBlockCalls;
   QElapsedTimer timer;
   timer.start();
 
-  QTextBlock block = currentBlock();
-  int blockStart   = block.position();
-  int blockEnd     = blockStart + text.length();
-
   // Safety check: ensure our cached text matches current document length
-  int docLength = document()->characterCount();
-  if (qAbs(m_lastText.length() - docLength) > 1) {// Allow 1 char tolerance for trailing newline
-    qDebug() << "[Highlighter] Cache mismatch! Cached:" << m_lastText.length() << "Doc:" << docLength
-             << "- forcing reparse";
+  int docLength    = document()->characterCount();
+  int cachedLength = static_cast<int>(m_buffer.utf16Length());
+  if (qAbs(cachedLength - docLength) > 1) {// Allow 1 char tolerance for trailing newline
+    qCWarning(lcHighlighter) << "Cache mismatch! Cached:" << cachedLength << "Doc:" << docLength
+                             << "- forcing reparse";
     // Schedule full reparse
     QMetaObject::invokeMethod(this, [this]() { forceReparse(); }, Qt::QueuedConnection);
     // return;
   }
 
-  // Convert to byte offsets using cached text (must match tree state)
-  int startByte = charOffsetToByte(blockStart, m_lastText);
-  int endByte   = charOffsetToByte(blockEnd, m_lastText);
+  // The spans were collected by one query walk over a line range; this
+  // block only copies its own into formats
+  const auto line = static_cast<uint32_t>(block.blockNumber());
+  if (!m_spansValid || line < m_spanFirstLine || line > m_spanLastLine) {
+    collectSpans(line, line + kSpanSweepLines - 1);
+  }
+  if (line > m_spanLastLine) return;// past the end of the buffer
 
-  TSQueryCursor *cursor = ts_query_cursor_new();
-  ts_query_cursor_set_byte_range(cursor, startByte, endByte);
-  ts_query_cursor_exec(cursor, m_languageInfo->highlightQuery, ts_tree_root_node(m_tree));
+  const uint32_t first = m_lineSpanOffsets[line - m_spanFirstLine];
+  const uint32_t last  = m_lineSpanOffsets[line - m_spanFirstLine + 1];
+  CW_HIGHLIGHT_TRACE(2) << "Block" << block.blockNumber() << ":" << text.left(40);
 
-  TSQueryMatch match;
-  int matchCount = 0;
-  std::vector<std::tuple<int, int, uint32_t, QString>> debugCaptures;// start, end, index, name
-
-  while (ts_query_cursor_next_match(cursor, &match)) {
-    ++matchCount;
-
-    for (uint16_t i = 0; i < match.capture_count; ++i) {
-      const TSQueryCapture &capture = match.captures[i];
-      uint32_t capStartByte         = ts_node_start_byte(capture.node);
-      uint32_t capEndByte           = ts_node_end_byte(capture.node);
-
-      // Convert to char offsets (document-wide)
-      int capStart = byteOffsetToChar(capStartByte);
-      int capEnd   = byteOffsetToChar(capEndByte);
-
-      // Clamp to block boundaries
-      int localStart = qMax(capStart, blockStart) - blockStart;
-      int localEnd   = qMin(capEnd, blockEnd) - blockStart;
-      int length     = localEnd - localStart;
-
-      if (length > 0 && localStart >= 0 && localEnd <= text.length()) {
-        auto it = m_captureIndexToFormat.find(capture.index);
-        if (it != m_captureIndexToFormat.end()) {
-          setFormat(localStart, length, it->second);
-
-          // Store for debug
-          uint32_t nameLen;
-          const char *name = ts_query_capture_name_for_id(m_languageInfo->highlightQuery, capture.index, &nameLen);
-          debugCaptures.push_back({ localStart, localEnd, capture.index, QString::fromUtf8(name, nameLen) });
-        }
-      }
-    }
+  for (uint32_t i = first; i < last; ++i) {
+    const HighlightSpan &span = m_spans[i];
+    const int localStart      = static_cast<int>(span.start);
+    const int localEnd        = qMin(static_cast<int>(span.start + span.length), text.length());
+    if (localEnd <= localStart) continue;
+
+    const QTextCharFormat *format = formatFor(span.layer, span.captureIndex);
+    if (!format) continue;
+    setFormat(localStart, localEnd - localStart, *format);
+
+    CW_HIGHLIGHT_TRACE(2) << "  " << localStart << "-" << localEnd << ":" << captureName(span.layer, span.captureIndex)
+                          << "'" << text.mid(localStart, localEnd - localStart) << "'";
   }
 
-  ts_query_cursor_delete(cursor);
   m_stats.totalHighlightTimeMs += timer.elapsed();
-  m_stats.lastMatchCount = matchCount;
+  m_stats.lastMatchCount = static_cast<int>(last - first);
+}
 
-  // Debug output: show captures for lines containing comments or if few captures
-  if (!debugCaptures.empty() && (text.contains("//") || text.contains("/*") || matchCount < 5)) {
-    qDebug() << "[Highlight] Block" << block.blockNumber() << ":" << text.left(40);
-    for (const auto &[s, e, idx, name] : debugCaptures) {
-      qDebug() << "  " << s << "-" << e << ":" << name << "'" << text.mid(s, e - s) << "'";
-    }
+void TreeSitterHighlighter::ensureSpans(uint32_t firstLine, uint32_t lastLine)
+{
+  if (m_spansValid && firstLine >= m_spanFirstLine && lastLine <= m_spanLastLine) return;
+  collectSpans(firstLine, lastLine);
+}
+
+// One ts_query_cursor captures walk over [firstLine, lastLine]. Captures come
+// out ordered by start; they are cut at line ends, converted to UTF-16
+// columns and bucketed per line (stable, so later captures still win).
+void TreeSitterHighlighter::collectSpans(uint32_t firstLine, uint32_t lastLine)
+{
+  m_spans.clear();
+  m_spanScratch.clear();
+  m_spanFirstLine = firstLine;
+  m_spanLastLine  = std::min(lastLine, m_buffer.lineCount() - 1);
+  m_spansValid    = true;
+  if (m_spanFirstLine > m_spanLastLine) {
+    m_lineSpanOffsets.assign(1, 0);
+    return;
   }
+  ++m_stats.spanSweeps;
+
+  const size_t startByte = m_buffer.lineStart(m_spanFirstLine);
+  const size_t endByte   = m_spanLastLine + 1 < m_buffer.lineCount() ? m_buffer.lineStart(m_spanLastLine + 1) : m_buffer.length();
+
+  // One cursor for the whole sweep, back to the pool right after
+  const CursorLease cursor = ParserPool::instance().acquireCursor();
+  appendSpans(cursor.get(), m_languageInfo->highlightQuery, ts_tree_root_node(m_tree), 0, startByte, endByte);
+
+  // Injected languages go after the host, so their formats win where they overlap
+  for (const InjectionLayer &layer : m_injections) {
+    if (layer.range.end_byte <= startByte || layer.range.start_byte >= endByte) continue;
+    appendSpans(cursor.get(),
+      layer.language->highlightQuery,
+      ts_tree_root_node(layer.tree.get()),
+      layerFormatsId(layer.language.get()),
+      std::max<size_t>(startByte, layer.range.start_byte),
+      std::min<size_t>(endByte, layer.range.end_byte));
+  }
+
+  // Counting sort into the flat arena
+  const uint32_t lines = m_spanLastLine - m_spanFirstLine + 1;
+  m_lineSpanOffsets.assign(lines + 1, 0);
+  for (const auto &entry : m_spanScratch) ++m_lineSpanOffsets[entry.first - m_spanFirstLine + 1];
+  for (uint32_t i = 0; i < lines; ++i) m_lineSpanOffsets[i + 1] += m_lineSpanOffsets[i];
+
+  m_spans.resize(m_spanScratch.size());
+  std::vector<uint32_t> fill(m_lineSpanOffsets.begin(), m_lineSpanOffsets.end() - 1);
+  for (const auto &[line, span] : m_spanScratch) m_spans[fill[line - m_spanFirstLine]++] = span;
 }
 
-// Offset conversions using cached UTF-8 that corresponds to current tree
-int TreeSitterHighlighter::charOffsetToByte(int charPos) const { return charOffsetToByte(charPos, m_lastText); }
+// Captures of one query over [startByte, endByte), cut at line ends, into m_spanScratch
+void TreeSitterHighlighter::appendSpans(TSQueryCursor *cursor,
+  const TSQuery *query,
+  TSNode root,
+  uint16_t layer,
+  size_t startByte,
+  size_t endByte)
+{
+  ts_query_cursor_set_byte_range(cursor, static_cast<uint32_t>(startByte), static_cast<uint32_t>(endByte));
+  ts_query_cursor_exec(cursor, query, root);
 
-int TreeSitterHighlighter::charOffsetToByte(int charPos, const QString &text) const
+  TSQueryMatch match;
+  uint32_t captureIndex = 0;
+  while (ts_query_cursor_next_capture(cursor, &match, &captureIndex)) {
+    const TSQueryCapture &capture = match.captures[captureIndex];
+    if (!formatFor(layer, capture.index)) continue;
+
+    const size_t capStart = std::max<size_t>(ts_node_start_byte(capture.node), startByte);
+    const size_t capEnd   = std::min<size_t>(ts_node_end_byte(capture.node), endByte);
+    if (capEnd <= capStart) continue;
+
+    const uint32_t startLine = m_buffer.positionFromOffset(capStart).line;
+    const uint32_t endLine   = m_buffer.positionFromOffset(capEnd).line;
+    for (uint32_t line = startLine; line <= endLine && line <= m_spanLastLine; ++line) {
+      const size_t lineStart = m_buffer.lineStart(line);
+      const size_t from      = line == startLine ? capStart : lineStart;
+      const size_t to        = line == endLine ? capEnd : lineStart + m_buffer.lineLength(line);
+      if (to <= from) continue;
+
+      const size_t lineStart16 = m_buffer.utf16FromOffset(lineStart);
+      const size_t from16      = m_buffer.utf16FromOffset(from);
+      const size_t to16        = m_buffer.utf16FromOffset(to);
+      m_spanScratch.push_back({ line,
+        { static_cast<uint32_t>(from16 - lineStart16),
+          static_cast<uint32_t>(to16 - from16),
+          static_cast<uint16_t>(capture.index),
+          layer } });
+    }
+  }
+}
+
+// Offset conversions through the text buffer: O(log n) plus at most one
+// checkpoint span (4 KiB) of decoding, instead of re-encoding the prefix
+int TreeSitterHighlighter::charOffsetToByte(int charPos) const
 {
   if (charPos <= 0) return 0;
-  if (charPos >= text.size()) return text.toUtf8().size();
-  return text.left(charPos).toUtf8().size();
+  return static_cast<int>(m_buffer.offsetFromUtf16(static_cast<size_t>(charPos)));
 }
 
 int TreeSitterHighlighter::byteOffsetToChar(int bytePos) const
 {
   if (bytePos <= 0) return 0;
-  if (bytePos >= m_lastUtf8.size()) return m_lastText.size();
-
-  // Decode UTF-8 up to bytePos
-  return QString::fromUtf8(m_lastUtf8.left(bytePos)).size();
+  return static_cast<int>(m_buffer.utf16FromOffset(static_cast<size_t>(bytePos)));
 }
 
 // Debug utilities
@@ -481,7 +1032,7 @@ void TreeSitterHighlighter::dumpSyntaxTree() const
     uint32_t end     = ts_node_end_byte(node);
 
     qDebug() << prefix << type << "[" << start << "-" << end << "]"
-             << QString::fromUtf8(m_lastUtf8.mid(start, end - start)).left(40);
+             << QString::fromStdString(m_buffer.substr(start, end - start)).left(40);
 
     uint32_t childCount = ts_node_child_count(node);
     for (uint32_t i = 0; i < childCount; ++i) { dump(ts_node_child(node, i), indent + 2); }
@@ -509,12 +1060,20 @@ void TreeSitterHighlighter::logNode(const TSNode &node, const char *context) con
            << "-" << byteOffsetToChar(end);
 }
 
+QString TreeSitterHighlighter::captureName(uint16_t layer, uint32_t captureIndex) const
+{
+  const TSQuery *query = layer == 0 ? m_languageInfo->highlightQuery : m_layerFormats[layer].first->highlightQuery;
+  uint32_t length      = 0;
+  const char *name     = ts_query_capture_name_for_id(query, captureIndex, &length);
+  return QString::fromUtf8(name, static_cast<qsizetype>(length));
+}
+
 std::string TreeSitterHighlighter::nodeString(const TSNode &node) const
 {
   if (ts_node_is_null(node)) return "NULL";
   uint32_t start = ts_node_start_byte(node);
   uint32_t end   = ts_node_end_byte(node);
-  return m_lastUtf8.mid(start, end - start).toStdString();
+  return m_buffer.substr(start, end - start);
 }
 
 }// namespace CodeWizard::Editor
\ No newline at end of file
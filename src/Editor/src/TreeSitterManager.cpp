@@ -1,6 +1,9 @@
 #include "Editor/TreeSitterManager.h"
+#include <Core/ThreadPool.h>
 #include <QDebug>
 #include <QDir>
+#include <QElapsedTimer>
+#include <string_view>
 
 // External language functions (declare these based on your linked libraries)
 extern "C" {
@@ -25,6 +28,8 @@ TreeSitterManager &TreeSitterManager::instance()
 
 void TreeSitterManager::initialize(const QString &queriesRootPath)
 {
+  QElapsedTimer timer;
+  timer.start();
   m_queriesRoot = queriesRootPath;
 
   // Register built-in languages
@@ -34,77 +39,194 @@ void TreeSitterManager::initialize(const QString &queriesRootPath)
   registerLanguage("javascript", tree_sitter_javascript, "javascript");
   registerLanguage("typescript", tree_sitter_typescript, "typescript");
   registerLanguage("rust", tree_sitter_rust, "rust");
+
+  m_initializeTimeUs = timer.nsecsElapsed() / 1000;
+  qDebug() << "Registered" << m_languages.size() << "languages in" << m_initializeTimeUs << "us";
 }
 
 void TreeSitterManager::registerLanguage(const QString &name, const TSLanguage *langFunc(), const QString &querySubdir)
 {
+  std::lock_guard lock(m_mutex);
+  LanguageDescriptor &descriptor = m_languages[name];
+  descriptor.factory             = langFunc;
+  descriptor.querySubdir         = querySubdir;
+  descriptor.future              = {};
+}
+
+LanguageFuture TreeSitterManager::loadLanguage(const QString &name)
+{
+  std::lock_guard lock(m_mutex);
+  auto it = m_languages.find(name);
+  if (it == m_languages.end()) return {};
+
+  LanguageDescriptor &descriptor = it->second;
+  if (descriptor.future.valid()) return descriptor.future;
+
   auto info       = std::make_shared<LanguageInfo>();
   info->name      = name;
-  info->language  = langFunc();
-  info->queryPath = m_queriesRoot + "/" + querySubdir + "/highlights.scm";
-
-  if (loadQuery(*info)) {
-    m_languages[name] = info;
-    qDebug() << "Registered language:" << name;
-  } else {
-    qWarning() << "Failed to load queries for:" << name;
-  }
+  info->language  = descriptor.factory();
+  info->queryDir  = descriptor.querySubdir;
+  info->queryPath = m_queriesRoot + "/" + descriptor.querySubdir + "/highlights.scm";
+
+  // ts_query_new is the expensive part (tens of ms for large grammars): keep it off the UI thread
+  descriptor.future = Core::globalThreadPool()
+                        .submit([this, info]() {
+                          QElapsedTimer timer;
+                          timer.start();
+                          if (loadQuery(*info)) {
+                            info->queryCompileMs = timer.elapsed();
+                            qDebug() << "Loaded language:" << info->name << "in" << info->queryCompileMs << "ms";
+                          } else {
+                            qWarning() << "Failed to load queries for:" << info->name;
+                          }
+                          return info;
+                        })
+                        .share();
+  return descriptor.future;
 }
 
-
-bool TreeSitterManager::loadQuery(LanguageInfo &info)
+std::shared_ptr<LanguageInfo> TreeSitterManager::getLanguage(const QString &name)
 {
+  LanguageFuture future = loadLanguage(name);
+  return future.valid() ? future.get() : nullptr;
+}
 
-  QByteArray combinedQuery;
+namespace {
+  // Parents named in a leading "; inherits: a,b" line; "(jsx)" marks an optional parent
+  QStringList inheritedQueries(const QByteArray &source)
+  {
+    static const QByteArray kDirective = "; inherits:";
+    if (!source.startsWith(kDirective)) return {};
+    const qsizetype end   = source.indexOf('\n');
+    const QString parents = QString::fromUtf8(source.mid(kDirective.size(), end < 0 ? -1 : end - kDirective.size()));
+
+    QStringList names;
+    for (QString name : parents.split(',', Qt::SkipEmptyParts)) {
+      name = name.trimmed();
+      if (name.startsWith('(') && name.endsWith(')')) name = name.mid(1, name.size() - 2);
+      if (!name.isEmpty()) names << name;
+    }
+    return names;
+  }
 
-  // Handle inheritance manually
-  if (info.name == "cpp") {
-    // Load C first (parent)
-    QFile cFile(m_queriesRoot + "/c/highlights.scm");
-    if (cFile.open(QIODevice::ReadOnly)) {
-      combinedQuery += cFile.readAll();
-      combinedQuery += "\n"; // Ensure newline separation
-      qDebug() << "Loaded inherited queries from c";
+  // Nested `; inherits:` chains deeper than this are treated as a cycle
+  constexpr int kMaxInheritanceDepth = 8;
+}// namespace
+
+bool TreeSitterManager::loadQuery(LanguageInfo &info) const
+{
+  info.highlightQuery = loadQuery(info, "highlights");
+  if (!info.highlightQuery) return false;
+
+  info.injectionQuery = loadQuery(info, "injections");
+  if (info.injectionQuery) resolveInjectionMetadata(info);
+
+  info.foldQuery = loadQuery(info, "folds");
+  if (info.foldQuery) {
+    for (uint32_t i = 0; i < ts_query_capture_count(info.foldQuery); ++i) {
+      uint32_t length  = 0;
+      const char *name = ts_query_capture_name_for_id(info.foldQuery, i, &length);
+      if (std::string_view(name, length) == "fold") info.foldCapture = i;
     }
   }
-  // Add other inheritance rules as needed:
-  // else if (querySubdir == "typescript") { load javascript first }
-  // else if (querySubdir == "tsx") { load typescript, then javascript }
-
-  // Load the language's own queries
-  QFile file(info.queryPath);
-  if (!file.open(QIODevice::ReadOnly)) {
-    qWarning() << "Cannot open query file:" << info.queryPath;
-    return false;
+  return true;
+}
+
+TSQuery *TreeSitterManager::loadQuery(const LanguageInfo &info, const QString &kind) const
+{
+  const QByteArray combinedQuery = readQuerySource(info.queryDir, kind);
+  if (combinedQuery.isNull()) {
+    if (kind == "highlights") qWarning() << "Cannot open query file:" << info.queryPath;
+    return nullptr;
   }
+  return compileQuery(info, combinedQuery, kind);
+}
+
+QByteArray TreeSitterManager::readQuerySource(const QString &queryDir, const QString &kind, int depth) const
+{
+  const QString path = m_queriesRoot + "/" + queryDir + "/" + kind + ".scm";
 
-  combinedQuery += file.readAll();
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly)) return {};
+  const QByteArray own = file.readAll();
 
+  // Parents first, so the language's own patterns come last and win
+  QByteArray combinedQuery;
+  for (const QString &parent : inheritedQueries(own)) {
+    if (depth >= kMaxInheritanceDepth) {
+      qWarning() << "Query inheritance too deep at" << path;
+      break;
+    }
+    const QByteArray inherited = readQuerySource(parent, kind, depth + 1);
+    if (inherited.isNull()) continue;
+    combinedQuery += inherited;
+    combinedQuery += "\n";// Ensure newline separation
+  }
+  combinedQuery += own;
+  return combinedQuery;
+}
+
+TSQuery *TreeSitterManager::compileQuery(const LanguageInfo &info, const QByteArray &source, const QString &kind) const
+{
   // Create query from combined source
   uint32_t errorOffset;
   TSQueryError errorType;
-  info.highlightQuery = ts_query_new(
+  TSQuery *query = ts_query_new(
       info.language,
-      combinedQuery.constData(),
-      combinedQuery.size(),
+      source.constData(),
+      source.size(),
       &errorOffset,
       &errorType
   );
 
-  if (!info.highlightQuery) {
+  if (!query) {
     qWarning() << "Query error at offset" << errorOffset
-               << "in combined query for" << info.queryPath;
-    return false;
+               << "in combined" << kind << "query for" << info.name;
   }
-
-  return true;
+  return query;
 }
 
-std::shared_ptr<LanguageInfo> TreeSitterManager::getLanguage(const QString &name) const
+void TreeSitterManager::resolveInjectionMetadata(LanguageInfo &info)
 {
-  return m_languages.at(name);
+  TSQuery *query = info.injectionQuery;
+  for (uint32_t i = 0; i < ts_query_capture_count(query); ++i) {
+    uint32_t length  = 0;
+    const char *name = ts_query_capture_name_for_id(query, i, &length);
+    const std::string_view capture(name, length);
+    if (capture == "injection.content") info.injectionContentCapture = i;
+    if (capture == "injection.language") info.injectionLanguageCapture = i;
+  }
+
+  // (#set! injection.language "name") — optionally with a capture before the key
+  const uint32_t patterns = ts_query_pattern_count(query);
+  info.injectionPatternLanguages.resize(patterns);
+  for (uint32_t pattern = 0; pattern < patterns; ++pattern) {
+    uint32_t stepCount                 = 0;
+    const TSQueryPredicateStep *steps = ts_query_predicates_for_pattern(query, pattern, &stepCount);
+
+    std::vector<std::string_view> strings;
+    for (uint32_t i = 0; i < stepCount; ++i) {
+      const TSQueryPredicateStep &step = steps[i];
+      if (step.type == TSQueryPredicateStepTypeString) {
+        uint32_t length  = 0;
+        const char *text = ts_query_string_value_for_id(query, step.value_id, &length);
+        strings.emplace_back(text, length);
+      } else if (step.type == TSQueryPredicateStepTypeDone) {
+        if (strings.size() == 3 && strings[0] == "set!" && strings[1] == "injection.language") {
+          info.injectionPatternLanguages[pattern] = QString::fromUtf8(strings[2].data(), static_cast<qsizetype>(strings[2].size()));
+        }
+        strings.clear();
+      }
+    }
+  }
 }
 
-std::ranges::elements_view<std::ranges::ref_view<const std::unordered_map<QString, std::shared_ptr<LanguageInfo>>>, 0>
-  TreeSitterManager::availableLanguages() const { return std::views::keys(m_languages); }
+std::vector<QString> TreeSitterManager::availableLanguages() const
+{
+  std::lock_guard lock(m_mutex);
+  std::vector<QString> names;
+  names.reserve(m_languages.size());
+  for (const auto &[name, descriptor] : m_languages) names.push_back(name);
+  return names;
+}
 }// namespace CodeWizard::Editor
\ No newline at end of file
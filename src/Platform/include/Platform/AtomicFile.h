@@ -0,0 +1,63 @@
+// include/Platform/AtomicFile.h
+#pragma once
+
+#include "Path.h"
+#include <Core/Result.h>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace CodeWizard::Platform {
+
+// How hard commit() pushes the data to disk before reporting success
+enum class SyncPolicy {
+    None,     // Leave it to the OS: fastest, a power loss may lose the new contents
+    Data,     // fdatasync the temp file before the rename: the renamed file is never empty
+    Full      // Also fsync the directory after the rename, so the rename itself survives
+};
+
+[[nodiscard]] SyncPolicy syncPolicyFromString(std::string_view name, SyncPolicy fallback = SyncPolicy::Data);
+
+// Replaces a file without ever exposing a partial one: data goes to a
+// temp file in the target's directory, commit() renames it over the
+// target. Until then the original is untouched; a writer destroyed
+// without commit() (or a crash) leaves only the temp file behind, which
+// the destructor removes when it gets the chance.
+class AtomicFileWriter {
+public:
+    AtomicFileWriter() = default;
+    ~AtomicFileWriter();
+
+    AtomicFileWriter(AtomicFileWriter&& other) noexcept;
+    AtomicFileWriter& operator=(AtomicFileWriter&& other) noexcept;
+
+    AtomicFileWriter(const AtomicFileWriter&) = delete;
+    AtomicFileWriter& operator=(const AtomicFileWriter&) = delete;
+
+    // Symlinks are followed: the file they point to is replaced. An existing
+    // target's permissions are carried over to the new file.
+    [[nodiscard]] static Core::Result<AtomicFileWriter> create(const Path& target);
+
+    // Buffered; nothing is visible at the target before commit()
+    [[nodiscard]] Core::Result<void> write(std::string_view data);
+    [[nodiscard]] Core::Result<void> commit(SyncPolicy policy);
+
+    [[nodiscard]] std::size_t bytesWritten() const noexcept { return m_written; }
+    [[nodiscard]] const std::string& tempPath() const noexcept { return m_tempPath; }
+
+private:
+    [[nodiscard]] Core::Result<void> flush();
+    void discard() noexcept;
+
+    std::string m_target;
+    std::string m_tempPath;
+    std::string m_buffer;
+    std::size_t m_written = 0;
+#ifdef _WIN32
+    void* m_handle = nullptr; // HANDLE
+#else
+    int m_fd = -1;
+#endif
+};
+
+} // namespace CodeWizard::Platform
@@ -0,0 +1,65 @@
+// include/Platform/FileLoader.h
+#pragma once
+
+#include "MappedFile.h"
+#include "Path.h"
+#include <Core/Result.h>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace CodeWizard::Platform {
+
+enum class TextEncoding {
+    Utf8,
+    Utf16LE,
+    Utf16BE,
+    Latin1 // Not valid UTF-8 and no BOM: bytes are taken as code points
+};
+
+// Where the time of one loadFile() went
+struct FileLoadMetrics {
+    std::uint64_t bytes = 0;
+    std::chrono::microseconds stat{};
+    std::chrono::microseconds read{}; // read() or mmap()
+    std::chrono::microseconds scan{}; // Encoding detection and line statistics
+
+    [[nodiscard]] std::chrono::microseconds total() const { return stat + read + scan; }
+};
+
+// A file read (or mapped) exactly once, with what callers need to decide
+// how to show it
+struct LoadedFile {
+    std::uint64_t size = 0;
+    bool mapped = false;  // Larger than the map threshold: `mapping` holds the file, `content` is empty
+    MappedFile mapping;
+    std::string content;  // Raw bytes, BOM included
+
+    TextEncoding encoding = TextEncoding::Utf8;
+    std::size_t bomLength = 0;
+    // Line statistics (not computed for mapped files); lengths in bytes without the line break
+    std::size_t lineCount = 0;
+    std::size_t longestLine = 0;
+
+    FileLoadMetrics metrics;
+
+    // The file's bytes after the BOM, wherever they live
+    [[nodiscard]] std::string_view text() const
+    {
+        const std::string_view bytes = mapped ? mapping.view() : std::string_view(content);
+        return bytes.substr(bomLength);
+    }
+};
+
+// Stat `path` once; files up to `mapThreshold` bytes are read with a single
+// read into one buffer, larger ones are memory-mapped. Encoding, BOM and
+// line statistics come from a pass over that same buffer.
+[[nodiscard]] Core::Result<LoadedFile> loadFile(const Path& path, std::uint64_t mapThreshold = UINT64_MAX);
+
+// BOM first, then UTF-16 without BOM (NUL bytes in every other position),
+// then UTF-8 validity. Looks at a bounded prefix only.
+[[nodiscard]] TextEncoding detectEncoding(std::string_view bytes, std::size_t& bomLength);
+
+} // namespace CodeWizard::Platform
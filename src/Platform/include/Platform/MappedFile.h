@@ -0,0 +1,52 @@
+// include/Platform/MappedFile.h
+#pragma once
+
+#include "Path.h"
+#include <Core/Result.h>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace CodeWizard::Platform {
+
+// Read-only memory mapping of a whole file. Nothing is read up front: the
+// OS loads pages on first access and may drop them again under memory
+// pressure, so opening a 2 GB file costs the same as opening a small one.
+// The file must not be truncated by another process while it is mapped.
+class MappedFile {
+public:
+    enum class Advice {
+        Normal,
+        Sequential, // Read ahead aggressively (one pass over the file)
+        Random,     // No read-ahead
+        DontNeed    // Drop the pages from this process; they are read again on access
+    };
+
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    [[nodiscard]] static Core::Result<MappedFile> open(const Path& path);
+
+    [[nodiscard]] bool isOpen() const noexcept { return m_open; }
+    [[nodiscard]] const char* data() const noexcept { return m_data; }
+    [[nodiscard]] std::size_t size() const noexcept { return m_size; }
+    [[nodiscard]] std::string_view view() const noexcept { return { m_data, m_size }; }
+
+    // Access hint for [offset, offset + length); a no-op where unsupported
+    void advise(Advice advice, std::size_t offset = 0, std::size_t length = SIZE_MAX) const;
+
+private:
+    void close() noexcept;
+
+    const char* m_data = nullptr;
+    std::size_t m_size = 0;
+    bool m_open = false; // Empty files are open without a mapping
+};
+
+} // namespace CodeWizard::Platform
@@ -0,0 +1,230 @@
+// src/AtomicFile.cpp
+#include "Platform/AtomicFile.h"
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+using namespace CodeWizard::Core;
+
+namespace CodeWizard::Platform {
+
+namespace {
+  constexpr std::size_t kBufferSize = 256 * 1024;
+
+#ifndef _WIN32
+  std::string describe(const std::string &what, const std::string &path)
+  {
+    return what + " " + path + ": " + std::strerror(errno);
+  }
+
+  ErrorCode errnoCode()
+  {
+    return errno == EACCES || errno == EPERM ? ErrorCode::PermissionDenied : ErrorCode::IoError;
+  }
+#endif
+}// namespace
+
+SyncPolicy syncPolicyFromString(std::string_view name, SyncPolicy fallback)
+{
+  if (name == "none") return SyncPolicy::None;
+  if (name == "data") return SyncPolicy::Data;
+  if (name == "full") return SyncPolicy::Full;
+  return fallback;
+}
+
+AtomicFileWriter::~AtomicFileWriter() { discard(); }
+
+AtomicFileWriter::AtomicFileWriter(AtomicFileWriter &&other) noexcept
+  : m_target(std::move(other.m_target)), m_tempPath(std::exchange(other.m_tempPath, {})),
+    m_buffer(std::move(other.m_buffer)), m_written(std::exchange(other.m_written, 0)),
+#ifdef _WIN32
+    m_handle(std::exchange(other.m_handle, nullptr))
+#else
+    m_fd(std::exchange(other.m_fd, -1))
+#endif
+{}
+
+AtomicFileWriter &AtomicFileWriter::operator=(AtomicFileWriter &&other) noexcept
+{
+  if (this != &other) {
+    discard();
+    m_target   = std::move(other.m_target);
+    m_tempPath = std::exchange(other.m_tempPath, {});
+    m_buffer   = std::move(other.m_buffer);
+    m_written  = std::exchange(other.m_written, 0);
+#ifdef _WIN32
+    m_handle = std::exchange(other.m_handle, nullptr);
+#else
+    m_fd = std::exchange(other.m_fd, -1);
+#endif
+  }
+  return *this;
+}
+
+Result<AtomicFileWriter> AtomicFileWriter::create(const Path &target)
+{
+  // Replace what a symlink points to, not the link; the temp file must be
+  // on the same file system as the target for the rename to be atomic
+  std::error_code ec;
+  fs::path resolved = fs::exists(target.native(), ec) ? fs::canonical(target.native(), ec) : fs::path(target.native());
+  if (ec) return failure<AtomicFileWriter>(ErrorCode::IoError, "Cannot resolve " + target.native() + ": " + ec.message());
+  resolved = fs::absolute(resolved, ec);
+
+  AtomicFileWriter writer;
+  writer.m_target = resolved.string();
+  const std::string prefix = (resolved.parent_path() / ("." + resolved.filename().string() + ".cw-save-")).string();
+  writer.m_buffer.reserve(kBufferSize);
+
+#ifdef _WIN32
+  for (unsigned attempt = 0; attempt < 16 && !writer.m_handle; ++attempt) {
+    const std::string candidate = prefix + std::to_string(GetCurrentProcessId()) + "-" + std::to_string(GetTickCount64() + attempt);
+    HANDLE handle = CreateFileA(
+      candidate.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle != INVALID_HANDLE_VALUE) {
+      writer.m_handle   = handle;
+      writer.m_tempPath = candidate;
+    } else if (GetLastError() != ERROR_FILE_EXISTS) {
+      break;
+    }
+  }
+  if (!writer.m_handle) return failure<AtomicFileWriter>(ErrorCode::IoError, "Cannot create temp file for " + writer.m_target);
+#else
+  std::string pattern = prefix + "XXXXXX";
+  writer.m_fd         = ::mkstemp(pattern.data());
+  if (writer.m_fd < 0) return failure<AtomicFileWriter>(errnoCode(), describe("Cannot create temp file for", writer.m_target));
+  writer.m_tempPath = pattern;
+  ::fcntl(writer.m_fd, F_SETFD, FD_CLOEXEC);
+
+  // mkstemp creates 0600; keep the mode the target had (or the umask default)
+  struct stat info{};
+  if (::stat(writer.m_target.c_str(), &info) == 0) {
+    ::fchmod(writer.m_fd, info.st_mode & 07777);
+  } else {
+    const mode_t mask = ::umask(0);
+    ::umask(mask);
+    ::fchmod(writer.m_fd, 0666 & ~mask);
+  }
+#endif
+  return success<AtomicFileWriter>(std::move(writer));
+}
+
+Result<void> AtomicFileWriter::write(std::string_view data)
+{
+  if (m_tempPath.empty()) return failure(ErrorCode::InvalidArgument, "Writer is not open");
+  if (m_buffer.size() + data.size() > kBufferSize) {
+    auto flushed = flush();
+    if (flushed.hasError()) return flushed;
+  }
+  if (data.size() >= kBufferSize) {
+    // Large pieces skip the buffer
+    m_buffer.assign(data);
+    auto flushed = flush();
+    m_buffer.clear();
+    return flushed;
+  }
+  m_buffer.append(data);
+  return success();
+}
+
+Result<void> AtomicFileWriter::flush()
+{
+  const char *data = m_buffer.data();
+  std::size_t left = m_buffer.size();
+  while (left > 0) {
+#ifdef _WIN32
+    DWORD written = 0;
+    const DWORD request = left > 0x40000000 ? 0x40000000 : static_cast<DWORD>(left);
+    if (!WriteFile(m_handle, data, request, &written, nullptr)) {
+      return failure(ErrorCode::IoError, "Write error: " + m_tempPath);
+    }
+#else
+    const ssize_t written = ::write(m_fd, data, left);
+    if (written < 0) {
+      if (errno == EINTR) continue;
+      return failure(errnoCode(), describe("Write error:", m_tempPath));
+    }
+#endif
+    data += written;
+    left -= static_cast<std::size_t>(written);
+    m_written += static_cast<std::size_t>(written);
+  }
+  m_buffer.clear();
+  return success();
+}
+
+Result<void> AtomicFileWriter::commit(SyncPolicy policy)
+{
+  if (m_tempPath.empty()) return failure(ErrorCode::InvalidArgument, "Writer is not open");
+  auto flushed = flush();
+  if (flushed.hasError()) return flushed;
+
+#ifdef _WIN32
+  if (policy != SyncPolicy::None && !FlushFileBuffers(m_handle)) {
+    return failure(ErrorCode::IoError, "Cannot sync " + m_tempPath);
+  }
+  CloseHandle(m_handle);
+  m_handle = nullptr;
+  const DWORD flags = MOVEFILE_REPLACE_EXISTING | (policy == SyncPolicy::Full ? MOVEFILE_WRITE_THROUGH : 0);
+  if (!MoveFileExA(m_tempPath.c_str(), m_target.c_str(), flags)) {
+    return failure(ErrorCode::IoError, "Cannot replace " + m_target);
+  }
+#else
+  if (policy != SyncPolicy::None) {
+#ifdef __APPLE__
+    const int synced = ::fsync(m_fd);
+#else
+    const int synced = ::fdatasync(m_fd);
+#endif
+    if (synced != 0) return failure(errnoCode(), describe("Cannot sync", m_tempPath));
+  }
+  if (::close(m_fd) != 0) {
+    m_fd = -1;
+    return failure(errnoCode(), describe("Cannot close", m_tempPath));
+  }
+  m_fd = -1;
+  if (::rename(m_tempPath.c_str(), m_target.c_str()) != 0) {
+    return failure(errnoCode(), describe("Cannot replace", m_target));
+  }
+  if (policy == SyncPolicy::Full) {
+    // The new directory entry is only durable once the directory is synced
+    const std::string directory = fs::path(m_target).parent_path().string();
+    const int dirFd             = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirFd >= 0) {
+      ::fsync(dirFd);
+      ::close(dirFd);
+    }
+  }
+#endif
+  m_tempPath.clear();
+  return success();
+}
+
+void AtomicFileWriter::discard() noexcept
+{
+#ifdef _WIN32
+  if (m_handle) {
+    CloseHandle(m_handle);
+    m_handle = nullptr;
+  }
+  if (!m_tempPath.empty()) DeleteFileA(m_tempPath.c_str());
+#else
+  if (m_fd >= 0) {
+    ::close(m_fd);
+    m_fd = -1;
+  }
+  if (!m_tempPath.empty()) ::unlink(m_tempPath.c_str());
+#endif
+  m_tempPath.clear();
+}
+
+}// namespace CodeWizard::Platform
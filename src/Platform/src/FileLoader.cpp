@@ -0,0 +1,154 @@
+// src/FileLoader.cpp
+#include "Platform/FileLoader.h"
+#include "Platform/FileSystem.h"
+#include <cstring>
+#include <fstream>
+
+using namespace CodeWizard::Core;
+
+namespace CodeWizard::Platform {
+
+namespace {
+  using Clock = std::chrono::steady_clock;
+
+  constexpr std::size_t kDetectionSample = 64 * 1024;
+
+  std::chrono::microseconds since(Clock::time_point start)
+  {
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start);
+  }
+
+  bool startsWith(std::string_view bytes, std::string_view prefix)
+  {
+    return bytes.size() >= prefix.size() && bytes.substr(0, prefix.size()) == prefix;
+  }
+
+  // A sequence cut off by the end of the sample counts as valid
+  bool isValidUtf8(std::string_view bytes)
+  {
+    const auto *data   = reinterpret_cast<const unsigned char *>(bytes.data());
+    const std::size_t size = bytes.size();
+    std::size_t i      = 0;
+    while (i < size) {
+      // ASCII runs eight bytes at a time
+      if (i + 8 <= size) {
+        std::uint64_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        if ((word & 0x8080808080808080ull) == 0) {
+          i += 8;
+          continue;
+        }
+      }
+      const unsigned char lead = data[i];
+      std::size_t length       = 0;
+      if (lead < 0x80) {
+        length = 1;
+      } else if (lead >= 0xC2 && lead <= 0xDF) {
+        length = 2;
+      } else if (lead >= 0xE0 && lead <= 0xEF) {
+        length = 3;
+      } else if (lead >= 0xF0 && lead <= 0xF4) {
+        length = 4;
+      } else {
+        return false;
+      }
+      for (std::size_t k = 1; k < length; ++k) {
+        if (i + k >= size) return true;
+        if ((data[i + k] & 0xC0) != 0x80) return false;
+      }
+      i += length;
+    }
+    return true;
+  }
+
+  void scanLines(std::string_view text, LoadedFile &file)
+  {
+    // memchr is vectorized by the C library; no per-byte loop here
+    const char *begin = text.data();
+    const char *end   = begin + text.size();
+    const char *line  = begin;
+    file.lineCount    = 1;
+    file.longestLine  = 0;
+    while (line < end) {
+      const void *found = std::memchr(line, '\n', static_cast<std::size_t>(end - line));
+      const char *stop  = found ? static_cast<const char *>(found) : end;
+      std::size_t length = static_cast<std::size_t>(stop - line);
+      if (length > 0 && stop[-1] == '\r') --length;
+      if (length > file.longestLine) file.longestLine = length;
+      if (!found) break;
+      ++file.lineCount;
+      line = stop + 1;
+    }
+  }
+}// namespace
+
+TextEncoding detectEncoding(std::string_view bytes, std::size_t &bomLength)
+{
+  bomLength = 0;
+  if (startsWith(bytes, "\xEF\xBB\xBF")) {
+    bomLength = 3;
+    return TextEncoding::Utf8;
+  }
+  if (startsWith(bytes, "\xFF\xFE")) {
+    bomLength = 2;
+    return TextEncoding::Utf16LE;
+  }
+  if (startsWith(bytes, "\xFE\xFF")) {
+    bomLength = 2;
+    return TextEncoding::Utf16BE;
+  }
+
+  const std::string_view sample = bytes.substr(0, kDetectionSample);
+  std::size_t evenZeros         = 0;
+  std::size_t oddZeros          = 0;
+  for (std::size_t i = 0; i + 1 < sample.size(); i += 2) {
+    evenZeros += sample[i] == '\0';
+    oddZeros += sample[i + 1] == '\0';
+  }
+  // Mostly-ASCII UTF-16 has a NUL in every other byte; UTF-8 text has none
+  const std::size_t pairs = sample.size() / 2;
+  if (pairs > 0 && oddZeros > pairs * 2 / 5 && evenZeros <= pairs / 20) return TextEncoding::Utf16LE;
+  if (pairs > 0 && evenZeros > pairs * 2 / 5 && oddZeros <= pairs / 20) return TextEncoding::Utf16BE;
+
+  return isValidUtf8(sample) ? TextEncoding::Utf8 : TextEncoding::Latin1;
+}
+
+Result<LoadedFile> loadFile(const Path &path, std::uint64_t mapThreshold)
+{
+  LoadedFile file;
+  Clock::time_point start = Clock::now();
+  auto info               = stat(path);
+  if (info.hasError()) return failure<LoadedFile>(info.error().code(), info.error().message());
+  if (!info.value().isFile) return failure<LoadedFile>(ErrorCode::InvalidArgument, "Not a file: " + path.native());
+  file.size          = info.value().size;
+  file.metrics.stat  = since(start);
+  file.metrics.bytes = file.size;
+
+  start = Clock::now();
+  if (file.size > mapThreshold) {
+    auto mapping = MappedFile::open(path);
+    if (mapping.hasError()) return failure<LoadedFile>(mapping.error().code(), mapping.error().message());
+    file.mapping = std::move(mapping).value();
+    file.mapped  = true;
+  } else {
+    std::ifstream stream(path.native(), std::ios::in | std::ios::binary);
+    if (!stream.is_open()) return failure<LoadedFile>(ErrorCode::IoError, "Cannot open file: " + path.native());
+    file.content.resize(file.size);
+    stream.read(file.content.data(), static_cast<std::streamsize>(file.content.size()));
+    if (stream.bad()) return failure<LoadedFile>(ErrorCode::IoError, "Read error: " + path.native());
+    // The file may have shrunk since stat(); keep what was actually read
+    file.content.resize(static_cast<std::size_t>(stream.gcount()));
+  }
+  file.metrics.read = since(start);
+
+  // Mapped files are only sampled: their lines are indexed lazily by the viewer
+  start         = Clock::now();
+  const std::string_view bytes = file.mapped ? file.mapping.view() : std::string_view(file.content);
+  file.encoding = detectEncoding(bytes, file.bomLength);
+  if (!file.mapped) scanLines(file.text(), file);
+  file.metrics.scan = since(start);
+
+  return success<LoadedFile>(std::move(file));
+}
+
+}// namespace CodeWizard::Platform
@@ -123,4 +123,25 @@ Result<void> remove(const Path &path, bool recursive)
   return success();
 }
 
+Result<FileInfo> stat(const Path &path)
+{
+  std::error_code ec;
+  const fs::file_status status = fs::status(path.native(), ec);
+  if (ec || !fs::exists(status)) {
+    return failure<FileInfo>(ec ? mapErrorCode(ec) : ErrorCode::FileNotFound, "Cannot stat: " + path.native());
+  }
+
+  FileInfo info;
+  info.path        = path;
+  info.isDirectory = fs::is_directory(status);
+  info.isFile      = fs::is_regular_file(status);
+  if (info.isFile) {
+    const std::uintmax_t size = fs::file_size(path.native(), ec);
+    if (!ec) info.size = size;
+  }
+  const auto ftime = fs::last_write_time(path.native(), ec);
+  if (!ec) info.lastModified = std::chrono::clock_cast<std::chrono::system_clock>(ftime);
+  return success<FileInfo>(std::move(info));
+}
+
 }// namespace CodeWizard::Platform
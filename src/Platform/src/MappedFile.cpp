@@ -0,0 +1,167 @@
+// src/MappedFile.cpp
+#include "Platform/MappedFile.h"
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace CodeWizard::Core;
+
+namespace CodeWizard::Platform {
+
+namespace {
+#ifndef _WIN32
+  ErrorCode mapErrno(int error)
+  {
+    switch (error) {
+    case ENOENT:
+      return ErrorCode::FileNotFound;
+    case EACCES:
+    case EPERM:
+      return ErrorCode::PermissionDenied;
+    case EISDIR:
+    case EINVAL:
+      return ErrorCode::InvalidArgument;
+    default:
+      return ErrorCode::IoError;
+    }
+  }
+#endif
+}// namespace
+
+MappedFile::~MappedFile() { close(); }
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+  : m_data(std::exchange(other.m_data, nullptr)), m_size(std::exchange(other.m_size, 0)),
+    m_open(std::exchange(other.m_open, false))
+{}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept
+{
+  if (this != &other) {
+    close();
+    m_data = std::exchange(other.m_data, nullptr);
+    m_size = std::exchange(other.m_size, 0);
+    m_open = std::exchange(other.m_open, false);
+  }
+  return *this;
+}
+
+Result<MappedFile> MappedFile::open(const Path &path)
+{
+  MappedFile file;
+#ifdef _WIN32
+  HANDLE handle = CreateFileA(path.native().c_str(),
+    GENERIC_READ,
+    FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+    nullptr,
+    OPEN_EXISTING,
+    FILE_ATTRIBUTE_NORMAL,
+    nullptr);
+  if (handle == INVALID_HANDLE_VALUE) {
+    const DWORD error = GetLastError();
+    const ErrorCode code = error == ERROR_FILE_NOT_FOUND || error == ERROR_PATH_NOT_FOUND ? ErrorCode::FileNotFound
+                           : error == ERROR_ACCESS_DENIED                                 ? ErrorCode::PermissionDenied
+                                                                                          : ErrorCode::IoError;
+    return failure<MappedFile>(code, "Cannot open file: " + path.native());
+  }
+  LARGE_INTEGER size{};
+  if (!GetFileSizeEx(handle, &size)) {
+    CloseHandle(handle);
+    return failure<MappedFile>(ErrorCode::IoError, "Cannot stat file: " + path.native());
+  }
+  file.m_size = static_cast<std::size_t>(size.QuadPart);
+  if (file.m_size > 0) {
+    // The view keeps the mapping object alive; neither handle is needed afterwards
+    HANDLE mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping) {
+      file.m_data = static_cast<const char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+      CloseHandle(mapping);
+    }
+    if (!file.m_data) {
+      CloseHandle(handle);
+      return failure<MappedFile>(ErrorCode::IoError, "Cannot map file: " + path.native());
+    }
+  }
+  CloseHandle(handle);
+#else
+  const int fd = ::open(path.native().c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    const int error = errno;
+    return failure<MappedFile>(mapErrno(error), "Cannot open file: " + path.native() + ": " + std::strerror(error));
+  }
+  struct stat info{};
+  if (::fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+    ::close(fd);
+    return failure<MappedFile>(ErrorCode::InvalidArgument, "Not a regular file: " + path.native());
+  }
+  file.m_size = static_cast<std::size_t>(info.st_size);
+  if (file.m_size > 0) {
+    // The mapping outlives the descriptor
+    void *data = ::mmap(nullptr, file.m_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+      const int error = errno;
+      ::close(fd);
+      return failure<MappedFile>(mapErrno(error), "Cannot map file: " + path.native() + ": " + std::strerror(error));
+    }
+    file.m_data = static_cast<const char *>(data);
+  }
+  ::close(fd);
+#endif
+  file.m_open = true;
+  return success<MappedFile>(std::move(file));
+}
+
+void MappedFile::advise(Advice advice, std::size_t offset, std::size_t length) const
+{
+  if (!m_data || offset >= m_size) return;
+  if (length > m_size - offset) length = m_size - offset;
+#ifdef _WIN32
+  (void)advice;
+  (void)length;
+#else
+  // madvise() wants a page-aligned start
+  const auto pageSize = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+  const std::size_t aligned = offset - offset % pageSize;
+  int flag = MADV_NORMAL;
+  switch (advice) {
+  case Advice::Normal:
+    flag = MADV_NORMAL;
+    break;
+  case Advice::Sequential:
+    flag = MADV_SEQUENTIAL;
+    break;
+  case Advice::Random:
+    flag = MADV_RANDOM;
+    break;
+  case Advice::DontNeed:
+    flag = MADV_DONTNEED;
+    break;
+  }
+  ::madvise(const_cast<char *>(m_data) + aligned, length + (offset - aligned), flag);
+#endif
+}
+
+void MappedFile::close() noexcept
+{
+  if (m_data) {
+#ifdef _WIN32
+    UnmapViewOfFile(m_data);
+#else
+    ::munmap(const_cast<char *>(m_data), m_size);
+#endif
+  }
+  m_data = nullptr;
+  m_size = 0;
+  m_open = false;
+}
+
+}// namespace CodeWizard::Platform
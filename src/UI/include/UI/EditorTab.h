@@ -1,9 +1,29 @@
 #pragma once
 
 #include "Editor/CodeTextEdit.h"
+#include "Editor/LargeFileView.h"
+#include "Platform/FileLoader.h"
 #include "Platform/Path.h"
+#include <Core/EventBus.h>
 #include <QVBoxLayout>
 #include <QWidget>
+#include <memory>
+
+// Posted by the save job when a file has been written (or could not be)
+struct FileSavedEvent
+{
+  QString file;
+  quint64 saveId;
+  bool ok;
+  QString error;
+  qint64 bytes;
+  qint64 durationMs;
+};
+template<> struct CodeWizard::Core::EventTraits<FileSavedEvent>
+{
+  static constexpr bool kThreadSafe = true;
+  static constexpr OverflowPolicy kOverflow = OverflowPolicy::Block;
+};
 
 namespace CodeWizard::UI {
 
@@ -12,11 +32,23 @@ class EditorTab final : public QWidget {
 
 public:
     explicit EditorTab(QWidget* parent = nullptr);
-    ~EditorTab() override = default;
+    ~EditorTab() override;
 
-    // File operations
-    bool loadFromFile(const QString& filepath);
+    // File operations. Loading runs on Core::ThreadPool and returns at once:
+    // the tab shows a placeholder, then the text as it is decoded, and emits
+    // loaded() or loadFailed() at the end.
+    void loadFromFile(const QString& filepath);
+    void cancelLoading();
+    // Back to an empty, editable, untitled tab: stops a load and drops the large-file view
+    void reset();
+    [[nodiscard]] bool isLoading() const { return m_load != nullptr; }
+    // Saving also runs on Core::ThreadPool, from a snapshot of the text, and
+    // atomically replaces the file; the result arrives as a FileSavedEvent.
+    // Returns false if the tab cannot be saved at all.
     bool saveToFile(const QString& filepath);
+    [[nodiscard]] bool isSaving() const { return m_saveId != 0; }
+    // Path of a save waiting for the one in flight, empty if none
+    [[nodiscard]] QString queuedSavePath() const { return m_queuedSavePath; }
 
     [[nodiscard]] bool isModified() const { return m_editor->document()->isModified(); }
     void setModified(bool modified) { m_editor->document()->setModified(modified); }
@@ -24,20 +56,46 @@ public:
     void setFilePath(const QString& filepath) { m_filePath = filepath; }
 
     [[nodiscard]] Editor::CodeTextEdit * getEditor() const { return m_editor; }
+    // Files over MAX_FILE_SIZE open in a read-only memory-mapped view instead of the editor
+    [[nodiscard]] bool isLargeFile() const { return m_largeView != nullptr; }
+    // Encoding found when the file was loaded, and where the load time went
+    [[nodiscard]] Platform::TextEncoding encoding() const { return m_encoding; }
+    [[nodiscard]] const Platform::FileLoadMetrics& loadMetrics() const { return m_loadMetrics; }
 
 signals:
     void modificationChanged(bool modified);
     void filePathChanged(const QString& filepath);
+    void loaded();
+    void loadFailed(const QString& error);
+    // One per finished save; `filepath` is where that save wrote
+    void saved(bool ok, const QString& filepath);
 
 private slots:
     void onModificationChanged(bool modified);
     void onFilePathChanged(const QString& path);
 private:
-    static bool isFileTooLarge(const CodeWizard::Platform::Path& filePath);
-    static bool hasVeryLongLine(const CodeWizard::Platform::Path& filePath, int maxLineLength = 100000);
+    // State shared with the load job running on Core::ThreadPool
+    struct LoadChannel;
 
+    // Loading tabs take turns inserting one chunk each, all within one
+    // shared frame budget; drainLoads() runs the turns
+    static void queueLoadDrain(EditorTab* tab);
+    static void drainLoads();
+    bool takeLoadedChunk(); // False once there is nothing more to insert for now
+    void finishLoading();
+    void onFileSaved(const FileSavedEvent& event);
+
+    std::shared_ptr<LoadChannel> m_load; // Set while a load is in flight
     Editor::CodeTextEdit * m_editor = nullptr;
+    Editor::LargeFileView* m_largeView = nullptr;
     QString m_filePath;
+    Platform::TextEncoding m_encoding = Platform::TextEncoding::Utf8;
+    Platform::FileLoadMetrics m_loadMetrics;
+    bool m_hasBom = false; // Written back on save
+
+    quint64 m_saveId = 0;        // Save in flight, 0 if none
+    int m_savedRevision = 0;     // Document revision the save in flight took its snapshot at
+    QString m_queuedSavePath;    // Save requested while another one was in flight
     QVBoxLayout* m_layout = nullptr;
 };
 
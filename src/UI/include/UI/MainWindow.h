@@ -48,6 +48,9 @@ private:
   void renderDiagnostics(const QList<LanguageIntelligence::Diagnostic> &diagnostics);
   [[nodiscard]] QString getSaveFileName(const QString &suggestedName);
   void openProject(const QString &projectPath);
+  void openFileInNewTab(const QString &filePath);
+  // Once the save of `tab` to `filePath` has finished: update the title (and the tab text if `rename`)
+  void followSave(EditorTab *tab, const QString &filePath, bool rename);
   static Platform::Path getCurrentWorkingDirectory();
   [[nodiscard]] EditorTab *currentTab() const;
   void onTabChanged(int index);
@@ -1,14 +1,127 @@
 #include "UI/EditorTab.h"
 #include <QMessageBox>
+#include <QElapsedTimer>
 #include <QFileInfo>
+#include <QStringDecoder>
+#include <QTextCursor>
+#include <QHash>
+#include <QPointer>
+#include <QStringEncoder>
+#include <QTimer>
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include "Platform/AtomicFile.h"
 #include "Platform/FileSystem.h"
+#include "Core/Config.h"
 #include "Core/Logger.h"
+#include "Core/ThreadPool.h"
 
 using namespace CodeWizard::UI;
 using namespace CodeWizard::Platform;
 
 static constexpr std::uint64_t MAX_FILE_SIZE = 15 * 1024 * 1024; // 15MB
-static constexpr int MAX_LINE_LENGTH = 1024 * 1024;
+static constexpr std::size_t MAX_LINE_LENGTH = 1024 * 1024;
+
+static constexpr std::size_t LOAD_CHUNK_BYTES = 256 * 1024;
+static constexpr qint64 LOAD_FRAME_BUDGET_MS = 8; // Inserting chunks, for all tabs together, never holds the event loop longer
+// "none", "data" (default) or "full"; see Platform::SyncPolicy
+static constexpr const char* SAVE_SYNC_POLICY_KEY = "editor.saveSyncPolicy";
+
+namespace {
+QStringConverter::Encoding converterFor(TextEncoding encoding) {
+    switch (encoding) {
+    case TextEncoding::Utf16LE:
+        return QStringConverter::Utf16LE;
+    case TextEncoding::Utf16BE:
+        return QStringConverter::Utf16BE;
+    case TextEncoding::Latin1:
+        return QStringConverter::Latin1;
+    case TextEncoding::Utf8:
+        break;
+    }
+    return QStringConverter::Utf8;
+}
+// Stream the snapshot piece by piece: no contiguous copy of the text
+Core::Result<void> writeText(Platform::AtomicFileWriter& writer, const Editor::TextBuffer& text,
+                             TextEncoding encoding, bool bom) {
+    const std::size_t length = text.length();
+    if (encoding == TextEncoding::Utf8) {
+        if (bom) {
+            auto written = writer.write("\xEF\xBB\xBF");
+            if (written.hasError()) return written;
+        }
+        for (std::size_t offset = 0; offset < length;) {
+            const std::string_view piece = text.chunkAt(offset);
+            if (piece.empty()) break;
+            auto written = writer.write(piece);
+            if (written.hasError()) return written;
+            offset += piece.size();
+        }
+        return Core::success();
+    }
+
+    // Back to the file's own encoding; the decoder carries sequences split between pieces
+    QStringDecoder decoder(QStringConverter::Utf8);
+    QStringEncoder encoder(converterFor(encoding), bom ? QStringConverter::Flag::WriteBom : QStringConverter::Flag::Default);
+    for (std::size_t offset = 0; offset < length;) {
+        const std::string_view piece = text.chunkAt(offset);
+        if (piece.empty()) break;
+        const QString decoded = decoder.decode(QByteArrayView(piece.data(), static_cast<qsizetype>(piece.size())));
+        const QByteArray encoded = encoder.encode(decoded);
+        // Latin-1 cannot hold everything the editor can type: refuse rather than write '?'
+        if (encoder.hasError()) {
+            return Core::failure(Core::ErrorCode::InvalidArgument,
+                                 std::string("The text contains characters that cannot be saved as ") + encoder.name()
+                                     + "; convert the file to UTF-8 to keep them");
+        }
+        auto written = writer.write(std::string_view(encoded.constData(), static_cast<std::size_t>(encoded.size())));
+        if (written.hasError()) return written;
+        offset += piece.size();
+    }
+    return Core::success();
+}
+
+// Tabs with chunks waiting, in turn order; see EditorTab::drainLoads()
+std::deque<QPointer<EditorTab>> loadDrainQueue;
+bool loadDrainScheduled = false;
+} // namespace
+
+// The job pushes decoded chunks; the tab takes them in turns with the other
+// loading tabs, a frame's worth at a time for all of them together.
+// Destroying or re-using the tab clears `owner` and stops the job.
+struct EditorTab::LoadChannel {
+    std::mutex mutex;
+    EditorTab* owner = nullptr;
+    std::atomic<bool> cancelled{false};
+    std::deque<QString> chunks;
+    bool drainQueued = false; // The tab is already queued for a turn
+    bool done = false;
+    std::shared_ptr<LoadedFile> file; // Without its bytes once decoded; null on error
+    QString error;
+    QElapsedTimer elapsed;
+
+    // Caller holds `mutex`
+    void notify() {
+        if (drainQueued || !owner) return;
+        drainQueued = true;
+        EditorTab* tab = owner;
+        QMetaObject::invokeMethod(tab, [tab]() { EditorTab::queueLoadDrain(tab); }, Qt::QueuedConnection);
+    }
+    void push(QString chunk) {
+        std::lock_guard lock(mutex);
+        chunks.push_back(std::move(chunk));
+        notify();
+    }
+    void finish(std::shared_ptr<LoadedFile> loaded, QString message) {
+        std::lock_guard lock(mutex);
+        file = std::move(loaded);
+        error = std::move(message);
+        done = true;
+        notify();
+    }
+};
 
 EditorTab::EditorTab(QWidget* parent)
     : QWidget(parent), m_editor(new Editor::CodeTextEdit(this)) {
@@ -22,92 +135,255 @@ EditorTab::EditorTab(QWidget* parent)
             this, &EditorTab::onModificationChanged);
 }
 
-bool EditorTab::loadFromFile(const QString& filepath) {
-    Path path(filepath.toStdString());
+EditorTab::~EditorTab() { cancelLoading(); }
 
-    // Check file size and long lines using Platform API
-    const bool fileTooLarge = isFileTooLarge(path);
-    const bool hasLongLines = hasVeryLongLine(path, MAX_LINE_LENGTH);
+void EditorTab::loadFromFile(const QString& filepath) {
+    reset();
+    setFilePath(filepath);
+    m_editor->setReadOnly(true);
+    m_editor->setPlaceholderText(tr("Loading %1...").arg(filepath));
+    // Chunks are appended as they come; none of them is an edit the user can undo
+    m_editor->document()->setUndoRedoEnabled(false);
 
-    if (hasLongLines) {
-        QMessageBox::warning(this,
-            tr("File with long lines"),
-            "This file contains very long lines.\n"
-            "Highlighting and editing is disabled for performance.");
-    }
+    auto channel = std::make_shared<LoadChannel>();
+    channel->owner = this;
+    channel->elapsed.start();
+    m_load = channel;
 
-    // Use Platform::readFile instead of QFile
-    auto result = Platform::readFile(path, Platform::ReadOption::Text);
-    if (result.hasError()) {
-        QMessageBox::warning(
-            this, tr("Error opening file"),
-            QString("Cannot read file %1:\n%2.").arg(filepath, QString::fromStdString(result.error().message())));
-        return false;
+    Core::globalThreadPool().post([channel, path = Path(filepath.toStdString())]() {
+        // One stat and one read (or mmap); long lines and encoding come from the same buffer
+        auto result = Platform::loadFile(path, MAX_FILE_SIZE);
+        if (channel->cancelled) return;
+        if (result.hasError()) {
+            channel->finish(nullptr, QString::fromStdString(result.error().message()));
+            return;
+        }
+        auto file = std::make_shared<LoadedFile>(std::move(result).value());
+
+        // Mapped files are shown by LargeFileView as they are; everything else is
+        // decoded here, off the UI thread, and streamed in whole lines so that a
+        // CRLF never straddles two inserts
+        if (!file->mapped) {
+            const std::string_view text = file->text();
+            QStringDecoder decoder(converterFor(file->encoding));
+            QString carry;
+            for (std::size_t offset = 0; offset < text.size(); offset += LOAD_CHUNK_BYTES) {
+                if (channel->cancelled) return;
+                const std::size_t length = std::min(LOAD_CHUNK_BYTES, text.size() - offset);
+                QString chunk = carry + QString(decoder.decode(QByteArrayView(text.data() + offset, static_cast<qsizetype>(length))));
+                const qsizetype cut = chunk.lastIndexOf(QLatin1Char('\n')) + 1;
+                carry = chunk.mid(cut);
+                chunk.truncate(cut);
+                if (!chunk.isEmpty()) channel->push(std::move(chunk));
+            }
+            if (!carry.isEmpty()) channel->push(std::move(carry));
+            file->content = {};
+        }
+        channel->finish(std::move(file), {});
+    });
+}
+
+void EditorTab::cancelLoading() {
+    if (!m_load) return;
+    {
+        std::lock_guard lock(m_load->mutex);
+        m_load->owner = nullptr;
+        m_load->cancelled = true;
     }
+    m_load.reset();
+    m_editor->setPlaceholderText({});
+    m_editor->setReadOnly(false);
+    m_editor->document()->setUndoRedoEnabled(true);
+}
 
-    QString fileContents = QString::fromStdString(result.value());
-    m_editor->setDocumentText(fileContents);
-    m_editor->setFileName(filepath);
+void EditorTab::reset() {
+    cancelLoading();
+    if (m_largeView) {
+        delete m_largeView;
+        m_largeView = nullptr;
+        m_editor->show();
+    }
+    m_editor->setDocumentText({});
+    m_encoding = Platform::TextEncoding::Utf8;
+    m_hasBom = false;
+    setFilePath({});
+    setModified(false);
+}
 
-    if (hasLongLines || fileTooLarge) {
-        m_editor->document()->setUndoRedoEnabled(false);
+void EditorTab::queueLoadDrain(EditorTab* tab) {
+    if (std::find(loadDrainQueue.begin(), loadDrainQueue.end(), tab) == loadDrainQueue.end()) {
+        loadDrainQueue.push_back(tab);
     }
+    if (loadDrainScheduled) return;
+    loadDrainScheduled = true;
+    QTimer::singleShot(0, &EditorTab::drainLoads);
+}
 
-    m_editor->document()->setModified(false);
-    setFilePath(filepath);
-    return true;
+void EditorTab::drainLoads() {
+    loadDrainScheduled = false;
+    QElapsedTimer budget;
+    budget.start();
+    while (!loadDrainQueue.empty()) {
+        const QPointer<EditorTab> tab = loadDrainQueue.front();
+        loadDrainQueue.pop_front();
+        if (tab && tab->takeLoadedChunk()) loadDrainQueue.push_back(tab);
+
+        // Out of time: let input and painting in first, however many tabs are loading
+        if (budget.elapsed() >= LOAD_FRAME_BUDGET_MS) break;
+    }
+    if (!loadDrainQueue.empty() && !loadDrainScheduled) {
+        loadDrainScheduled = true;
+        QTimer::singleShot(0, &EditorTab::drainLoads);
+    }
 }
 
-bool EditorTab::saveToFile(const QString& filepath) {
-    Path path(filepath.toStdString());
-    QString content = m_editor->documentText();
+bool EditorTab::takeLoadedChunk() {
+    const std::shared_ptr<LoadChannel> channel = m_load;
+    if (!channel) return false;
 
-    // Use Platform::writeFile instead of QFile
-    auto result = Platform::writeFile(path, content.toStdString(), Platform::WriteOption::Text);
-    if (result.hasError()) {
-        QMessageBox::warning(this, "Save Error",
-            QString("Cannot write file %1:\n%2.").arg(filepath, QString::fromStdString(result.error().message())));
+    QString chunk;
+    {
+        std::lock_guard lock(channel->mutex);
+        if (channel->chunks.empty()) {
+            channel->drainQueued = false;
+            if (!channel->done) return false; // The next push() queues the tab again
+        } else {
+            chunk = std::move(channel->chunks.front());
+            channel->chunks.pop_front();
+        }
+    }
+    if (chunk.isEmpty()) {
+        finishLoading();
         return false;
     }
 
-    setFilePath(filepath);
-    setModified(false);
+    QTextCursor cursor(m_editor->document());
+    cursor.movePosition(QTextCursor::End);
+    cursor.insertText(chunk);
     return true;
 }
 
-void EditorTab::onModificationChanged(bool modifier) {
-    emit modificationChanged(isModified());
-}
-void EditorTab::onFilePathChanged(const QString &path) {}
+void EditorTab::finishLoading() {
+    const std::shared_ptr<LoadChannel> channel = std::move(m_load);
+    m_editor->setPlaceholderText({});
+
+    if (!channel->file) {
+        m_editor->setReadOnly(false);
+        m_editor->document()->setUndoRedoEnabled(true);
+        QMessageBox::warning(
+            this, tr("Error opening file"),
+            QString("Cannot read file %1:\n%2.").arg(m_filePath, channel->error));
+        emit loadFailed(channel->error);
+        return;
+    }
 
-bool EditorTab::isFileTooLarge(const Path& filePath) {
-  auto result = Platform::readFile(filePath, Platform::ReadOption::Binary);
-  return result.hasValue() && result.value().size() > MAX_FILE_SIZE;
+    LoadedFile& file = *channel->file;
+    if (file.mapped) {
+        // Too large for QTextDocument: view the mapped file read-only
+        m_largeView = new Editor::LargeFileView(std::move(file.mapping), converterFor(file.encoding),
+                                                file.bomLength, this);
+        m_layout->addWidget(m_largeView);
+        m_editor->hide();
+    } else {
+        const bool hasLongLines = file.longestLine > MAX_LINE_LENGTH;
+        if (hasLongLines) {
+            QMessageBox::warning(this,
+                tr("File with long lines"),
+                "This file contains very long lines.\n"
+                "Highlighting and editing is disabled for performance.");
+        }
+
+        // Highlighting starts once, on the complete text
+        m_editor->setFileName(m_filePath);
+        m_editor->setReadOnly(false);
+        m_editor->document()->setUndoRedoEnabled(!hasLongLines);
+        m_editor->moveCursor(QTextCursor::Start);
+    }
+    m_encoding = file.encoding;
+    m_hasBom = file.bomLength > 0;
+    m_loadMetrics = file.metrics;
+    CW_LOG_INFO("Loaded " + m_filePath.toStdString() + ": " + std::to_string(file.metrics.bytes) + " bytes, stat "
+                + std::to_string(file.metrics.stat.count()) + " us, " + (file.mapped ? "map " : "read ")
+                + std::to_string(file.metrics.read.count()) + " us, scan " + std::to_string(file.metrics.scan.count())
+                + " us, on screen after " + std::to_string(channel->elapsed.elapsed()) + " ms");
+
+    m_editor->document()->setModified(false);
+    emit loaded();
 }
 
-bool EditorTab::hasVeryLongLine(const Path& filePath, int maxLineLength) {
-    auto result = Platform::readFile(filePath, Platform::ReadOption::Binary);
-    if (result.hasError()) return false;
+bool EditorTab::saveToFile(const QString& filepath) {
+    if (m_load) {
+        // Only part of the text is there yet: saving it would truncate the file
+        QMessageBox::warning(this, "Save Error", tr("The file is still loading."));
+        return false;
+    }
+    if (m_largeView) {
+        QMessageBox::warning(this, "Save Error", tr("Large files are opened read-only."));
+        return false;
+    }
+    if (m_saveId != 0) {
+        // One save at a time, so an older snapshot can never be renamed over a newer one
+        m_queuedSavePath = filepath;
+        return true;
+    }
 
-    const std::string& content = result.value();
-    int currentLineLength = 0;
-    bool foundLongLine = false;
+    // One subscription for all tabs, routed by save id; a tab closed while
+    // its save runs simply drops out of the table
+    static QHash<quint64, QPointer<EditorTab>> pendingSaves;
+    static const auto subscription = Core::EventBus<FileSavedEvent>::subscribe([](const FileSavedEvent& event) {
+        const QPointer<EditorTab> tab = pendingSaves.take(event.saveId);
+        if (tab && tab->m_saveId == event.saveId) tab->onFileSaved(event);
+    });
+    static quint64 nextSaveId = 1;
+    m_saveId = nextSaveId++;
+    pendingSaves.insert(m_saveId, this);
+    m_savedRevision = m_editor->document()->revision();
 
-    for (const char chr : content) {
-        if (chr == '\n' || chr == '\r') {
-            if (currentLineLength > maxLineLength) {
-                foundLongLine = true;
-                break;
-            }
-            currentLineLength = 0;
-        } else {
-            currentLineLength++;
+    const Platform::SyncPolicy policy = Platform::syncPolicyFromString(
+        Core::Config::instance().getString(SAVE_SYNC_POLICY_KEY).value_or(""), Platform::SyncPolicy::Data);
+    Core::globalThreadPool().post([text = m_editor->snapshot(), filepath, saveId = m_saveId, encoding = m_encoding,
+                                      bom = m_hasBom, policy]() {
+        QElapsedTimer timer;
+        timer.start();
+        FileSavedEvent event{ filepath, saveId, false, {}, 0, 0 };
+
+        auto writer = Platform::AtomicFileWriter::create(Path(filepath.toStdString()));
+        Core::Result<void> status = writer.hasError() ? Core::Result<void>(writer.error()) : Core::Result<void>();
+        if (status.hasValue()) status = writeText(writer.value(), text, encoding, bom);
+        if (status.hasValue()) status = writer.value().commit(policy);
+
+        event.ok = status.hasValue();
+        if (status.hasError()) event.error = QString::fromStdString(status.error().message());
+        if (writer.hasValue()) event.bytes = static_cast<qint64>(writer.value().bytesWritten());
+        event.durationMs = timer.elapsed();
+        // Delivered on the UI thread by the EventDispatcher
+        Core::postEvent(std::move(event));
+    });
+    return true;
+}
+
+void EditorTab::onFileSaved(const FileSavedEvent& event) {
+    m_saveId = 0;
+    if (!event.ok) {
+        QMessageBox::warning(this, "Save Error",
+            QString("Cannot write file %1:\n%2.").arg(event.file, event.error));
+    } else {
+        CW_LOG_INFO("Saved " + event.file.toStdString() + ": " + std::to_string(event.bytes) + " bytes in "
+                    + std::to_string(event.durationMs) + " ms");
+        if (event.file != m_filePath) {
+            setFilePath(event.file);
+            emit filePathChanged(event.file);
         }
+        // Edits made while the save ran are not in the file
+        if (m_editor->document()->revision() == m_savedRevision) setModified(false);
     }
+    emit saved(event.ok, event.file);
 
-    if (!foundLongLine && currentLineLength > maxLineLength) {
-        foundLongLine = true;
-    }
+    if (!m_queuedSavePath.isEmpty()) saveToFile(std::exchange(m_queuedSavePath, {}));
+}
 
-    return foundLongLine;
+void EditorTab::onModificationChanged(bool modifier) {
+    if (m_load) return; // Loaded chunks are not modifications
+    emit modificationChanged(isModified());
 }
+void EditorTab::onFilePathChanged(const QString &path) {}
@@ -12,6 +12,7 @@
 #include <QSplitter>
 #include <QVBoxLayout>
 #include <Editor/TreeSitterHighlighter.h>
+#include <memory>
 
 using namespace CodeWizard;
 
@@ -137,25 +138,33 @@ void MainWindow::onOpenFile() {
 
   if (filePath.isEmpty()) return;
 
-  EditorTab* newTab = new EditorTab(this);
-
-  if (newTab->loadFromFile(filePath)) {
-    connect(newTab, &EditorTab::modificationChanged,
-            this, &MainWindow::onModificationChanged);
-    connect(newTab, &EditorTab::filePathChanged,
-            this, &MainWindow::onFilePathChanged);
+  openFileInNewTab(filePath);
+}
 
-    Platform::Path path(filePath.toStdString());
-    QString fileName = QString::fromStdString(path.filename());
-    int index = m_tabWidget->addTab(newTab, fileName);
-    m_tabWidget->setCurrentIndex(index);
+void MainWindow::openFileInNewTab(const QString &filePath)
+{
+  // The tab shows up right away; the text streams in from Core::ThreadPool
+  EditorTab* newTab = new EditorTab(this);
+  connect(newTab, &EditorTab::modificationChanged,
+          this, &MainWindow::onModificationChanged);
+  connect(newTab, &EditorTab::filePathChanged,
+          this, &MainWindow::onFilePathChanged);
+  connect(newTab, &EditorTab::loadFailed, this, [this, newTab]() {
+    const int index = m_tabWidget->indexOf(newTab);
+    if (index != -1) m_tabWidget->removeTab(index);
+    newTab->deleteLater();
+  });
+
+  Platform::Path path(filePath.toStdString());
+  QString fileName = QString::fromStdString(path.filename());
+  int index = m_tabWidget->addTab(newTab, fileName);
+  m_tabWidget->setCurrentIndex(index);
+  newTab->loadFromFile(filePath);
 
-    m_saveFileAction->setEnabled(true);
-    m_saveFileAsAction->setEnabled(true);
-  } else {
-    delete newTab;
-  }
+  m_saveFileAction->setEnabled(true);
+  m_saveFileAsAction->setEnabled(true);
 }
+
 void MainWindow::onSaveFile() {
   EditorTab* tab = currentTab();
   if (!tab) return;
@@ -166,9 +175,9 @@ void MainWindow::onSaveFile() {
     return;
   }
 
-  if (tab->saveToFile(filePath)) {
-    updateWindowTitle();
-  }
+  // The write finishes in the background; the title follows once it has
+  if (!tab->saveToFile(filePath)) return;
+  followSave(tab, filePath, false);
 }
 
 void MainWindow::onSaveFileAs() {
@@ -181,12 +190,29 @@ void MainWindow::onSaveFileAs() {
   QString filePath = getSaveFileName(suggestedName);
   if (filePath.isEmpty()) return;
 
-  if (tab->saveToFile(filePath)) {
-    Platform::Path path(filePath.toStdString());
-    QString fileName = QString::fromStdString(path.filename());
-    m_tabWidget->setTabText(m_tabWidget->currentIndex(), fileName);
+  if (!tab->saveToFile(filePath)) return;
+  followSave(tab, filePath, true);
+}
+
+void MainWindow::followSave(EditorTab *tab, const QString &filePath, bool rename) {
+  // A save already in flight only queues this one: wait for the result
+  // that is about this path, not the first one that arrives
+  auto connection = std::make_shared<QMetaObject::Connection>();
+  *connection = connect(tab, &EditorTab::saved, this,
+                        [this, tab, filePath, rename, connection](bool ok, const QString &savedPath) {
+    if (savedPath != filePath) {
+      // A later request replaced the queued one: this save will not happen
+      if (tab->queuedSavePath() != filePath) disconnect(*connection);
+      return;
+    }
+    disconnect(*connection);
+    if (ok && rename) {
+      Platform::Path path(filePath.toStdString());
+      QString fileName = QString::fromStdString(path.filename());
+      m_tabWidget->setTabText(m_tabWidget->indexOf(tab), fileName);
+    }
     updateWindowTitle();
-  }
+  });
 }
 void MainWindow::openProject(const QString &projectPath)
 {
@@ -202,24 +228,7 @@ void MainWindow::onCommandSubmitted(const QString &command)
 
 void MainWindow::onFileOpenedFromSidebar(const QString &filePath)
 {
-  EditorTab* newTab = new EditorTab(this);
-
-  if (newTab->loadFromFile(filePath)) {
-    connect(newTab, &EditorTab::modificationChanged,
-            this, &MainWindow::onModificationChanged);
-    connect(newTab, &EditorTab::filePathChanged,
-            this, &MainWindow::onFilePathChanged);
-
-    Platform::Path path(filePath.toStdString());
-    QString fileName = QString::fromStdString(path.filename());
-    int index = m_tabWidget->addTab(newTab, fileName);
-    m_tabWidget->setCurrentIndex(index);
-
-    m_saveFileAction->setEnabled(true);
-    m_saveFileAsAction->setEnabled(true);
-  } else {
-    delete newTab;
-  }
+  openFileInNewTab(filePath);
 }
 
 void MainWindow::onFilePathChanged(const QString& filepath) {
@@ -245,9 +254,7 @@ void MainWindow::onCloseTab(int index) {
     // Don't close last tab, just clear it
     EditorTab* tab = qobject_cast<EditorTab*>(m_tabWidget->widget(index));
     if (tab != nullptr) {
-      tab->getEditor()->setDocumentText("");
-      tab->setFilePath("");
-      tab->setModified(false);
+      tab->reset();
       m_tabWidget->setTabText(index, tr("Untitled"));
     }
     return;
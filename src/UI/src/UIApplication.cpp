@@ -1,25 +1,38 @@
 #include "UI/UIApplication.h"
 #include "UI/MainWindow.h"
 #include "Theme/ThemeEngine.h"
+#include <Core/EventDispatcher.h>
+#include <Core/Logger.h>
 #include <QApplication>
+#include <QElapsedTimer>
 #include <QTimer>
+#include <string>
 namespace CodeWizard::UI {
 
 int UIApplication::run(int argc, char** argv)
 {
+  QElapsedTimer startup;
+  startup.start();
   QApplication app(argc, argv);
   auto& theme = Theme::ThemeEngine::instance();
   theme.setTheme(Theme::ThemeType::CatppuccinMocha); // or load from config
   theme.applyToApplication();
   Editor::TreeSitterManager::instance().initialize(":/queries");
+  const qint64 languagesUs = Editor::TreeSitterManager::instance().initializeTimeUs();
   m_window = new MainWindow();
   m_window->show();
-  QTimer::singleShot(0, []() {
-    EventBus<IncChangeEvent>::poll();
-    EventBus<CursorMovedEvent>::poll();
-    EventBus<SelectionEvent>::poll();
+
+  // Startup instrumentation: the first event loop pass runs right after the first paint is queued
+  QTimer::singleShot(0, [startup, languagesUs]() {
+    CW_LOG_INFO("Startup: languages registered in " + std::to_string(languagesUs) + " us, event loop running after "
+                + std::to_string(startup.elapsed()) + " ms");
   });
-  return app.exec();
+  // Every EventBus is delivered from here on, as events are posted
+  Core::EventDispatcher::instance().attach();
+  const int status = app.exec();
+  Core::EventDispatcher::instance().logStats();
+  Core::EventDispatcher::instance().detach();
+  return status;
 }
 
 }// namespace CodeWizard::UI
\ No newline at end of file
@@ -0,0 +1,297 @@
+#include <catch2/catch_test_macros.hpp>
+#include <Core/EventBus.h>
+#include <atomic>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace CodeWizard::Core;
+
+namespace {
+// Every test uses its own event types: each type has its own bus
+std::atomic<int> liveEvents{0};
+
+struct Tracked {
+    Tracked() { ++liveEvents; }
+    Tracked(const Tracked&) { ++liveEvents; }
+    Tracked(Tracked&&) noexcept { ++liveEvents; }
+    Tracked& operator=(const Tracked&) = default;
+    Tracked& operator=(Tracked&&) noexcept = default;
+    ~Tracked() { --liveEvents; }
+};
+
+struct BlockEvent { int producer; int seq; };
+struct EarlyBlockEvent { int value; };
+struct DropOldestEvent { int value; Tracked tracked; };
+struct DropNewestEvent { int value; };
+struct CoalesceEvent { int value; };
+struct LocalEvent { int value; };
+struct KeyedEvent { std::string file; int pos; };
+struct BatchEvent { int value; };
+struct ManyListenersEvent { int value; };
+struct SelfRemovingEvent { int value; };
+}
+
+template<> struct CodeWizard::Core::EventTraits<BlockEvent> {
+    static constexpr bool kThreadSafe = true;
+    static constexpr OverflowPolicy kOverflow = OverflowPolicy::Block;
+};
+template<> struct CodeWizard::Core::EventTraits<EarlyBlockEvent> {
+    static constexpr bool kThreadSafe = true;
+    static constexpr OverflowPolicy kOverflow = OverflowPolicy::Block;
+};
+template<> struct CodeWizard::Core::EventTraits<DropOldestEvent> {
+    static constexpr bool kThreadSafe = true;
+};
+template<> struct CodeWizard::Core::EventTraits<DropNewestEvent> {
+    static constexpr bool kThreadSafe = true;
+    static constexpr OverflowPolicy kOverflow = OverflowPolicy::DropNewest;
+};
+template<> struct CodeWizard::Core::EventTraits<KeyedEvent> {
+    static constexpr bool kThreadSafe = true;
+    static const std::string& coalesceKey(const KeyedEvent& ev) { return ev.file; }
+};
+template<> struct CodeWizard::Core::EventTraits<CoalesceEvent> {
+    static constexpr bool kThreadSafe = true;
+    static constexpr OverflowPolicy kOverflow = OverflowPolicy::Coalesce;
+};
+
+TEST_CASE("EventBus delivers every event from many producers under Block", "[core][eventbus]") {
+    constexpr int kProducers = 4;
+    constexpr int kPerProducer = 50000;
+
+    std::vector<int> next(kProducers, 0);
+    bool ordered = true;
+    auto handle = EventBus<BlockEvent>::subscribe([&](const BlockEvent& ev) {
+        // Each producer's events arrive in the order it posted them
+        if (ev.seq != next[ev.producer]) ordered = false;
+        next[ev.producer] = ev.seq + 1;
+    });
+    // This thread delivers: it claims the bus before any producer posts
+    EventBus<BlockEvent>::poll();
+
+    std::atomic<int> running{kProducers};
+    std::vector<std::thread> producers;
+    for (int p = 0; p < kProducers; ++p) {
+        producers.emplace_back([p, &running]() {
+            for (int i = 0; i < kPerProducer; ++i) postEvent(BlockEvent{p, i});
+            --running;
+        });
+    }
+    while (running > 0) EventBus<BlockEvent>::poll();
+    for (auto& producer : producers) producer.join();
+    EventBus<BlockEvent>::poll();
+
+    REQUIRE(ordered);
+    for (int p = 0; p < kProducers; ++p) REQUIRE(next[p] == kPerProducer);
+    const EventBusStats stats = EventBus<BlockEvent>::stats();
+    REQUIRE(stats.posted == kProducers * kPerProducer);
+    REQUIRE(stats.delivered == stats.posted);
+    REQUIRE(stats.dropped == 0);
+    REQUIRE(stats.highWater <= 1024);
+}
+
+TEST_CASE("EventBus under Block drains in place on the thread that owns it", "[core][eventbus]") {
+    std::vector<int> values;
+    auto handle = EventBus<EarlyBlockEvent>::subscribe([&](const EarlyBlockEvent& ev) { values.push_back(ev.value); });
+
+    // Far more than the ring holds, before anything was ever polled
+    for (int i = 0; i < 1500; ++i) postEvent(EarlyBlockEvent{i});
+
+    // A poll from another thread does not take the bus over
+    std::thread([]() { EventBus<EarlyBlockEvent>::poll(); }).join();
+    for (int i = 1500; i < 3000; ++i) postEvent(EarlyBlockEvent{i});
+    EventBus<EarlyBlockEvent>::poll();
+
+    REQUIRE(values.size() == 3000);
+    for (int i = 0; i < 3000; ++i) REQUIRE(values[i] == i);
+    REQUIRE(EventBus<EarlyBlockEvent>::stats().dropped == 0);
+}
+
+TEST_CASE("EventBus drops and destroys the oldest events when full", "[core][eventbus]") {
+    constexpr int kProducers = 4;
+    constexpr int kPerProducer = 20000;
+
+    std::atomic<long> delivered{0};
+    auto handle = EventBus<DropOldestEvent>::subscribe([&](const DropOldestEvent&) { ++delivered; });
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < kProducers; ++p) {
+        producers.emplace_back([]() {
+            for (int i = 0; i < kPerProducer; ++i) postEvent(DropOldestEvent{i, {}});
+        });
+    }
+    // A slow consumer, so the ring overflows
+    std::atomic<bool> stop{false};
+    std::thread consumer([&stop]() {
+        while (!stop) {
+            EventBus<DropOldestEvent>::poll();
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+    });
+    for (auto& producer : producers) producer.join();
+    stop = true;
+    consumer.join();
+    EventBus<DropOldestEvent>::poll();
+
+    const EventBusStats stats = EventBus<DropOldestEvent>::stats();
+    REQUIRE(stats.posted == kProducers * kPerProducer);
+    REQUIRE(stats.dropped > 0);
+    REQUIRE(stats.delivered + stats.dropped == stats.posted);
+    REQUIRE(delivered == static_cast<long>(stats.delivered));
+    REQUIRE(stats.highWater == 1024);
+    REQUIRE(liveEvents == 0); // Dropped events were destroyed too
+}
+
+TEST_CASE("EventBus drops the newest events when full", "[core][eventbus]") {
+    std::vector<int> values;
+    auto handle = EventBus<DropNewestEvent>::subscribe([&](const DropNewestEvent& ev) { values.push_back(ev.value); });
+
+    for (int i = 0; i < 1100; ++i) postEvent(DropNewestEvent{i});
+    EventBus<DropNewestEvent>::poll();
+
+    REQUIRE(values.size() == 1024);
+    REQUIRE(values.front() == 0);
+    REQUIRE(values.back() == 1023);
+    REQUIRE(EventBus<DropNewestEvent>::stats().dropped == 1100 - 1024);
+}
+
+TEST_CASE("EventBus coalesces overflow into the newest event", "[core][eventbus]") {
+    std::vector<int> values;
+    auto handle = EventBus<CoalesceEvent>::subscribe([&](const CoalesceEvent& ev) { values.push_back(ev.value); });
+
+    for (int i = 0; i < 1100; ++i) postEvent(CoalesceEvent{i});
+    EventBus<CoalesceEvent>::poll();
+
+    REQUIRE(values.size() == 1025);
+    REQUIRE(values[1023] == 1023);
+    REQUIRE(values.back() == 1099);
+    REQUIRE(EventBus<CoalesceEvent>::stats().coalesced == 1100 - 1025);
+    REQUIRE(EventBus<CoalesceEvent>::stats().dropped == 0);
+
+    // Back to the ring once the overflow was delivered
+    postEvent(CoalesceEvent{2000});
+    EventBus<CoalesceEvent>::poll();
+    REQUIRE(values.back() == 2000);
+}
+
+TEST_CASE("EventBus drains in place when a single-threaded ring is full", "[core][eventbus]") {
+    int count = 0;
+    auto handle = EventBus<LocalEvent>::subscribe([&](const LocalEvent&) { ++count; });
+
+    for (int i = 0; i < 3000; ++i) postEvent(LocalEvent{i});
+    EventBus<LocalEvent>::poll();
+
+    REQUIRE(count == 3000);
+    REQUIRE(EventBus<LocalEvent>::stats().dropped == 0);
+}
+
+TEST_CASE("EventBus keeps only the latest event per key until poll", "[core][eventbus]") {
+    std::vector<KeyedEvent> seen;
+    auto handle = EventBus<KeyedEvent>::subscribe([&](const KeyedEvent& ev) { seen.push_back(ev); });
+
+    // A held arrow key in two files: far more than the ring holds
+    for (int i = 0; i < 5000; ++i) {
+        postEvent(KeyedEvent{"a.cpp", i});
+        if (i % 2 == 0) postEvent(KeyedEvent{"b.cpp", i});
+    }
+    EventBus<KeyedEvent>::poll();
+
+    REQUIRE(seen.size() == 2);
+    REQUIRE(seen[0].file == "a.cpp"); // Keys keep the order they first showed up in
+    REQUIRE(seen[0].pos == 4999);
+    REQUIRE(seen[1].file == "b.cpp");
+    REQUIRE(seen[1].pos == 4998);
+    const EventBusStats stats = EventBus<KeyedEvent>::stats();
+    REQUIRE(stats.posted == 7500);
+    REQUIRE(stats.delivered == 2);
+    REQUIRE(stats.coalesced == 7498);
+    REQUIRE(stats.dropped == 0);
+
+    seen.clear();
+    EventBus<KeyedEvent>::poll();
+    REQUIRE(seen.empty());
+    postEvent(KeyedEvent{"b.cpp", 1});
+    EventBus<KeyedEvent>::poll();
+    REQUIRE(seen.size() == 1);
+    REQUIRE(seen[0].pos == 1);
+}
+
+TEST_CASE("EventBus batch listeners get contiguous runs straight from the ring", "[core][eventbus]") {
+    std::vector<std::size_t> runs;
+    std::vector<int> batched;
+    std::vector<int> single;
+    auto batchHandle = EventBus<BatchEvent>::subscribeBatch([&](std::span<const BatchEvent> events) {
+        runs.push_back(events.size());
+        for (const BatchEvent& ev : events) batched.push_back(ev.value);
+    });
+    auto handle = EventBus<BatchEvent>::subscribe([&](const BatchEvent& ev) { single.push_back(ev.value); });
+
+    for (int i = 0; i < 1000; ++i) postEvent(BatchEvent{i});
+    EventBus<BatchEvent>::poll();
+    REQUIRE(runs == std::vector<std::size_t>{1000});
+
+    // These wrap around the end of the ring: two runs
+    runs.clear();
+    for (int i = 1000; i < 1100; ++i) postEvent(BatchEvent{i});
+    EventBus<BatchEvent>::poll();
+    REQUIRE(runs == std::vector<std::size_t>{24, 76});
+
+    REQUIRE(batched.size() == 1100);
+    for (int i = 0; i < 1100; ++i) REQUIRE(batched[i] == i);
+    REQUIRE(single == batched);
+    REQUIRE(EventBus<BatchEvent>::stats().delivered == 1100);
+
+    // Unsubscribed batch listeners are not called any more
+    batchHandle = {};
+    postEvent(BatchEvent{1100});
+    EventBus<BatchEvent>::poll();
+    REQUIRE(batched.size() == 1100);
+    REQUIRE(single.size() == 1101);
+}
+
+TEST_CASE("EventBus takes any number of listeners and reuses freed slots", "[core][eventbus]") {
+    int calls = 0;
+    std::vector<EventBus<ManyListenersEvent>::Handle> handles;
+    for (int i = 0; i < 500; ++i) {
+        handles.push_back(EventBus<ManyListenersEvent>::subscribe([&](const ManyListenersEvent&) { ++calls; }));
+    }
+    postEvent(ManyListenersEvent{0});
+    EventBus<ManyListenersEvent>::poll();
+    REQUIRE(calls == 500);
+
+    // A long session opening and closing tabs
+    for (int round = 0; round < 1000; ++round) {
+        handles[round % handles.size()] =
+            EventBus<ManyListenersEvent>::subscribe([&](const ManyListenersEvent&) { ++calls; });
+    }
+    calls = 0;
+    postEvent(ManyListenersEvent{1});
+    EventBus<ManyListenersEvent>::poll();
+    REQUIRE(calls == 500);
+
+    handles.resize(100);
+    calls = 0;
+    postEvent(ManyListenersEvent{2});
+    EventBus<ManyListenersEvent>::poll();
+    REQUIRE(calls == 100);
+}
+
+TEST_CASE("EventBus listeners may unsubscribe while being called", "[core][eventbus]") {
+    std::vector<int> seen;
+    EventBus<SelfRemovingEvent>::Handle handle;
+    handle = EventBus<SelfRemovingEvent>::subscribe([&](const SelfRemovingEvent& ev) {
+        seen.push_back(ev.value);
+        handle = {};
+    });
+    int others = 0;
+    auto other = EventBus<SelfRemovingEvent>::subscribe([&](const SelfRemovingEvent&) { ++others; });
+
+    postEvent(SelfRemovingEvent{1});
+    postEvent(SelfRemovingEvent{2});
+    EventBus<SelfRemovingEvent>::poll();
+
+    REQUIRE(seen == std::vector<int>{1});
+    REQUIRE(others == 2);
+}
@@ -0,0 +1,96 @@
+#include <catch2/catch_test_macros.hpp>
+#include <Core/EventBus.h>
+#include <Core/EventDispatcher.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+using namespace CodeWizard::Core;
+
+namespace {
+struct PumpedA { int value; };
+struct PumpedB { int value; };
+struct PumpedKeyed { std::string file; int value; };
+struct SlowEvent { int value; };
+}
+
+template<> struct CodeWizard::Core::EventTraits<PumpedKeyed> {
+    static constexpr bool kThreadSafe = true;
+    static const std::string& coalesceKey(const PumpedKeyed& ev) { return ev.file; }
+};
+
+TEST_CASE("Latency histogram buckets and percentiles", "[core][dispatcher]") {
+    LatencyHistogram histogram;
+    REQUIRE(histogram.percentile(0.5).count() == 0);
+
+    histogram.record(500);         // < 1 us
+    histogram.record(3'000);       // [2, 4) us
+    histogram.record(3'500);
+    histogram.record(1'000'000);   // 1 ms: [512, 1024) us
+    histogram.record(-5);          // Clock skew counts as zero
+    REQUIRE(histogram.count() == 5);
+    REQUIRE(histogram.bucket(0) == 2);
+    REQUIRE(histogram.bucket(2) == 2);
+    REQUIRE(histogram.bucket(10) == 1);
+    REQUIRE(histogram.percentile(0.5).count() == 4);
+    REQUIRE(histogram.percentile(1.0).count() == 1024);
+
+    histogram.record(INT64_MAX);   // Lands in the last bucket
+    REQUIRE(histogram.bucket(LatencyHistogram::kBuckets - 1) == 1);
+    histogram.reset();
+    REQUIRE(histogram.count() == 0);
+}
+
+TEST_CASE("Dispatcher pumps every bus that was used", "[core][dispatcher]") {
+    std::vector<int> a;
+    std::vector<int> b;
+    std::vector<int> keyed;
+    auto handleA = EventBus<PumpedA>::subscribe([&](const PumpedA& ev) { a.push_back(ev.value); });
+    auto handleB = EventBus<PumpedB>::subscribe([&](const PumpedB& ev) { b.push_back(ev.value); });
+    auto handleK = EventBus<PumpedKeyed>::subscribe([&](const PumpedKeyed& ev) { keyed.push_back(ev.value); });
+
+    postEvent(PumpedA{1});
+    postEvent(PumpedB{2});
+    postEvent(PumpedA{3});
+    postEvent(PumpedKeyed{"x", 4});
+    postEvent(PumpedKeyed{"x", 5});
+
+    // Registered without any list of types
+    std::vector<std::string> names;
+    EventDispatcher::instance().forEachQueue([&](const EventQueue& queue) { names.emplace_back(queue.queueName()); });
+    REQUIRE(std::find(names.begin(), names.end(), typeid(PumpedA).name()) != names.end());
+    REQUIRE(std::find(names.begin(), names.end(), typeid(PumpedB).name()) != names.end());
+
+    REQUIRE(EventDispatcher::instance().pump(std::chrono::seconds(1)));
+    REQUIRE(a == std::vector<int>{1, 3});
+    REQUIRE(b == std::vector<int>{2});
+    REQUIRE(keyed == std::vector<int>{5});
+
+    REQUIRE(EventBus<PumpedA>::latency().count() == 2);
+    REQUIRE(EventBus<PumpedKeyed>::latency().count() == 1);
+    REQUIRE(EventBus<PumpedA>::stats().delivered == 2);
+}
+
+TEST_CASE("Dispatcher stops at the frame budget and resumes", "[core][dispatcher]") {
+    std::vector<int> values;
+    auto handle = EventBus<SlowEvent>::subscribe([&](const SlowEvent& ev) { values.push_back(ev.value); });
+
+    for (int i = 0; i < 1000; ++i) postEvent(SlowEvent{i});
+    EventBus<SlowEvent>::poll();
+    // These wrap around the end of the ring: two runs
+    for (int i = 1000; i < 2000; ++i) postEvent(SlowEvent{i});
+
+    // A zero budget still delivers one run per pump
+    REQUIRE_FALSE(EventDispatcher::instance().pump(std::chrono::microseconds(0)));
+    REQUIRE(values.size() == 1024);
+    REQUIRE(EventDispatcher::instance().pump(std::chrono::microseconds(0)));
+    REQUIRE(values.size() == 2000);
+    for (int i = 0; i < 2000; ++i) REQUIRE(values[i] == i);
+    REQUIRE(EventBus<SlowEvent>::latency().count() == 2000);
+
+    // Nothing pending: done right away
+    REQUIRE(EventDispatcher::instance().pump(std::chrono::microseconds(0)));
+}
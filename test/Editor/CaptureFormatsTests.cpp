@@ -0,0 +1,75 @@
+#include <catch2/catch_test_macros.hpp>
+#include <Editor/CaptureFormats.h>
+#include <QColor>
+#include <cstring>
+
+extern "C" const TSLanguage *tree_sitter_cpp();
+
+using namespace CodeWizard::Editor;
+
+namespace {
+HighlightTheme makeTheme(const QColor &function)
+{
+    HighlightTheme theme;
+    theme["function"].setForeground(function);
+    theme["keyword"].setFontWeight(QFont::Bold);
+    return theme;
+}
+
+uint32_t captureId(const TSQuery *query, const char *name)
+{
+    for (uint32_t i = 0; i < ts_query_capture_count(query); ++i) {
+        uint32_t length = 0;
+        const char *capture = ts_query_capture_name_for_id(query, i, &length);
+        if (length == std::strlen(name) && std::strncmp(capture, name, length) == 0) return i;
+    }
+    FAIL("no capture " << name);
+    return 0;
+}
+} // namespace
+
+TEST_CASE("CaptureFormats resolves parent names and leaves the rest unstyled", "[editor][captureformats]") {
+    const char source[] = "(call_expression) @function.method.call (identifier) @variable \"return\" @keyword";
+    uint32_t errorOffset = 0;
+    TSQueryError error = TSQueryErrorNone;
+    TSQuery *query = ts_query_new(tree_sitter_cpp(), source, static_cast<uint32_t>(std::strlen(source)), &errorOffset, &error);
+    REQUIRE(query);
+
+    auto theme = CaptureFormats::instance().intern(makeTheme(Qt::blue));
+    auto table = CaptureFormats::instance().table(query, theme);
+    REQUIRE(table);
+    REQUIRE(table->formats.size() == ts_query_capture_count(query));
+
+    const QTextCharFormat *call = table->at(captureId(query, "function.method.call"));
+    REQUIRE(call);
+    REQUIRE(call->foreground().color() == QColor(Qt::blue));
+    REQUIRE(table->at(captureId(query, "keyword")));
+    REQUIRE(table->at(captureId(query, "variable")) == nullptr);
+    REQUIRE(table->at(1000) == nullptr);
+
+    ts_query_delete(query);
+}
+
+TEST_CASE("CaptureFormats shares one table per language and theme", "[editor][captureformats]") {
+    const char source[] = "(identifier) @function";
+    uint32_t errorOffset = 0;
+    TSQueryError error = TSQueryErrorNone;
+    TSQuery *query = ts_query_new(tree_sitter_cpp(), source, static_cast<uint32_t>(std::strlen(source)), &errorOffset, &error);
+    REQUIRE(query);
+
+    CaptureFormats &formats = CaptureFormats::instance();
+    auto first = formats.intern(makeTheme(Qt::red));
+    auto second = formats.intern(makeTheme(Qt::red));
+    auto other = formats.intern(makeTheme(Qt::green));
+    REQUIRE(first == second);
+    REQUIRE(first != other);
+
+    auto a = formats.table(query, first);
+    auto b = formats.table(query, second);
+    auto c = formats.table(query, other);
+    REQUIRE(a == b);
+    REQUIRE(a != c);
+    REQUIRE(c->at(0)->foreground().color() == QColor(Qt::green));
+
+    ts_query_delete(query);
+}
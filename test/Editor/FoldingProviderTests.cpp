@@ -0,0 +1,83 @@
+#include <catch2/catch_test_macros.hpp>
+#include <Editor/FoldingProvider.h>
+#include <cstring>
+#include <memory>
+
+extern "C" const TSLanguage *tree_sitter_cpp();
+
+using namespace CodeWizard::Editor;
+
+namespace {
+struct Parsed
+{
+    TextBuffer text;
+    TSTree *tree = nullptr;
+
+    explicit Parsed(std::string_view source)
+    {
+        text.setText(source);
+        TSParser *parser = ts_parser_new();
+        ts_parser_set_language(parser, tree_sitter_cpp());
+        tree = ts_parser_parse_string(parser, nullptr, source.data(), static_cast<uint32_t>(source.size()));
+        ts_parser_delete(parser);
+    }
+    ~Parsed() { ts_tree_delete(tree); }
+};
+
+// LanguageInfo owns its queries and must not be copied
+std::unique_ptr<LanguageInfo> foldLanguage()
+{
+    static constexpr const char *kQuery = "(compound_statement) @fold (field_declaration_list) @fold";
+    auto info = std::make_unique<LanguageInfo>();
+    info->language = tree_sitter_cpp();
+    uint32_t errorOffset = 0;
+    TSQueryError error = TSQueryErrorNone;
+    info->foldQuery = ts_query_new(info->language, kQuery, static_cast<uint32_t>(std::strlen(kQuery)), &errorOffset, &error);
+    info->foldCapture = 0;
+    return info;
+}
+} // namespace
+
+TEST_CASE("Folds cover multi-line nodes and keep closing-brace lines visible", "[editor][folding]") {
+    const auto language = foldLanguage();
+    REQUIRE(language->foldQuery);
+    const Parsed doc("struct S {\n  int a;\n};\nint f() {\n  return 1;\n}\nint g() { return 2; }\n");
+
+    const FoldRegions folds = findFolds(*language, doc.tree, doc.text, {}, {}, true);
+    REQUIRE(folds.size() == 2); // g() fits on one line
+    CHECK(folds[0].headerLine() == 0);
+    CHECK(folds[0].firstHiddenLine() == 1);
+    CHECK(folds[0].lastHiddenLine() == 1);
+    CHECK(folds[1].headerLine() == 3);
+    CHECK(folds[1].lastHiddenLine() == 4);
+}
+
+TEST_CASE("Collapsed folds survive a parse that keeps them and are released otherwise", "[editor][folding]") {
+    const auto language = foldLanguage();
+    const Parsed before("int f() {\n  return 1;\n}\nint g() {\n  return 2;\n}\n");
+
+    FoldingProvider provider;
+    provider.adopt(findFolds(*language, before.tree, before.text, {}, {}, true));
+    REQUIRE(provider.regions().size() == 2);
+    provider.regionAt(0)->collapsed = true;
+    provider.regionAt(3)->collapsed = true;
+
+    // Delete the body of g(): f() is untouched and stays collapsed
+    const Parsed after("int f() {\n  return 1;\n}\nint g();\n");
+    TSInputEdit edit{};
+    edit.start_byte = 31;
+    edit.old_end_byte = 48;
+    edit.new_end_byte = 33;
+    edit.start_point = { 3, 7 };
+    edit.old_end_point = { 6, 0 };
+    edit.new_end_point = { 4, 0 };
+    provider.edit(edit);
+
+    const std::vector<std::pair<size_t, size_t>> changed{ { 31, 33 } };
+    provider.adopt(findFolds(*language, after.tree, after.text, provider.regions(), changed, false));
+    REQUIRE(provider.regions().size() == 1);
+    REQUIRE(provider.collapsedAt(0));
+
+    CHECK(provider.takeReleased().size() == 1);
+    CHECK(provider.takeReleased().empty());
+}
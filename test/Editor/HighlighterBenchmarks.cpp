@@ -0,0 +1,245 @@
+#include "HighlighterTestSupport.h"
+#include <Core/Config.h>
+#include <Editor/HighlightBudget.h>
+#include <Editor/HighlighterLogging.h>
+#include <Editor/TreeSitterHighlighter.h>
+#include <Editor/TreeSitterManager.h>
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QLoggingCategory>
+#include <QTimer>
+#include <QTextDocument>
+#include <algorithm>
+#include <catch2/catch_test_macros.hpp>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+using namespace CodeWizard::Editor;
+using namespace CodeWizard::Editor::Testing;
+
+namespace {
+
+// Milliseconds for one full highlight pass over a document of `bytes` bytes
+qint64 highlightPassMs(qsizetype bytes)
+{
+    QTextDocument document;
+    document.setPlainText(generateSource(bytes));
+    TreeSitterHighlighter highlighter(&document);
+    REQUIRE(highlighter.setLanguage("cpp"));
+    waitForParse(highlighter);
+    REQUIRE(highlighter.isHealthy());
+
+    QElapsedTimer timer;
+    timer.start();
+    highlighter.rehighlight();
+    return timer.elapsed();
+}
+
+} // namespace
+
+TEST_CASE("Highlight pass scales linearly with document size", "[.][benchmark][highlighter]") {
+    application();
+
+    constexpr qsizetype kMiB = 1024 * 1024;
+    const std::vector<qsizetype> sizes{ 1 * kMiB, 2 * kMiB, 4 * kMiB, 8 * kMiB };
+    std::vector<qint64> times;
+    std::cout << "highlight pass:";
+    for (qsizetype size : sizes) {
+        times.push_back(std::max<qint64>(highlightPassMs(size), 1));
+        std::cout << " " << size / kMiB << " MiB " << times.back() << " ms;";
+    }
+    std::cout << "\n";
+
+    // Linear scaling: doubling the text may roughly double the time, and
+    // across all sizes the slope may not grow; a quadratic pass quadruples
+    for (size_t i = 1; i < times.size(); ++i) CHECK(times[i] <= 3 * times[i - 1]);
+    CHECK(times.back() <= 12 * times.front());
+}
+
+TEST_CASE("Lazy mode time to first frame and backfill", "[.][benchmark][highlighter]") {
+    application();
+
+    QTextDocument document;
+    document.setPlainText(generateSource(10 * 1024 * 1024));
+    TreeSitterHighlighter highlighter(&document);
+    highlighter.setLazyHighlighting(true);
+    highlighter.setVisibleBlocks(0, 60);
+    REQUIRE(highlighter.setLanguage("cpp"));
+    waitForParse(highlighter);
+    REQUIRE(highlighter.isHealthy());
+
+    // Everything up to parsingFinished happened before the first paint
+    const HighlightStatistics first = highlighter.statistics();
+    std::cout << "lazy open of " << document.blockCount() << " blocks: " << first.highlightBlockCalls
+              << " blocks formatted in " << first.totalHighlightTimeMs << " ms before the first frame\n";
+
+    // Idle slices fill in the rest without ever blocking for long
+    QElapsedTimer timer;
+    timer.start();
+    while (highlighter.statistics().backfilledBlocks + 300 < document.blockCount() && timer.elapsed() < 120'000) {
+        QCoreApplication::processEvents();
+    }
+    std::cout << "backfill of " << highlighter.statistics().backfilledBlocks << " blocks took " << timer.elapsed()
+              << " ms\n";
+}
+
+TEST_CASE("Single capture sweep beats one query cursor per block", "[.][benchmark][highlighter]") {
+    application();
+
+    auto language = TreeSitterManager::instance().getLanguage("cpp");
+    REQUIRE(language);
+    const QByteArray source = generateSource(1024 * 1024).toUtf8();
+
+    TSParser *parser = ts_parser_new();
+    ts_parser_set_language(parser, language->language);
+    TSTree *tree = ts_parser_parse_string(parser, nullptr, source.constData(), static_cast<uint32_t>(source.size()));
+    REQUIRE(tree);
+    const TSNode root = ts_tree_root_node(tree);
+
+    std::vector<uint32_t> lineStarts{ 0 };
+    for (qsizetype i = 0; i < source.size(); ++i) {
+        if (source[i] == '\n') lineStarts.push_back(static_cast<uint32_t>(i + 1));
+    }
+    lineStarts.push_back(static_cast<uint32_t>(source.size()));
+
+    // Old highlightBlock: a fresh cursor and query execution for every line
+    QElapsedTimer timer;
+    timer.start();
+    size_t perBlockCaptures = 0;
+    for (size_t line = 0; line + 1 < lineStarts.size(); ++line) {
+        TSQueryCursor *cursor = ts_query_cursor_new();
+        ts_query_cursor_set_byte_range(cursor, lineStarts[line], lineStarts[line + 1]);
+        ts_query_cursor_exec(cursor, language->highlightQuery, root);
+        TSQueryMatch match;
+        while (ts_query_cursor_next_match(cursor, &match)) perBlockCaptures += match.capture_count;
+        ts_query_cursor_delete(cursor);
+    }
+    const qint64 perBlockMs = timer.restart();
+
+    // Span table: one cursor, one captures walk over the whole range
+    size_t sweepCaptures = 0;
+    TSQueryCursor *cursor = ts_query_cursor_new();
+    ts_query_cursor_set_byte_range(cursor, 0, static_cast<uint32_t>(source.size()));
+    ts_query_cursor_exec(cursor, language->highlightQuery, root);
+    TSQueryMatch match;
+    uint32_t captureIndex = 0;
+    while (ts_query_cursor_next_capture(cursor, &match, &captureIndex)) ++sweepCaptures;
+    ts_query_cursor_delete(cursor);
+    const qint64 sweepMs = timer.elapsed();
+
+    std::cout << lineStarts.size() - 1 << " lines: cursor per block " << perBlockMs << " ms (" << perBlockCaptures
+              << " captures), single sweep " << sweepMs << " ms (" << sweepCaptures << " captures)\n";
+
+    ts_tree_delete(tree);
+    ts_parser_delete(parser);
+
+    CHECK(sweepCaptures > 0);
+    CHECK(sweepMs <= perBlockMs);
+}
+
+TEST_CASE("Language registration defers query compilation to first use", "[.][benchmark][highlighter]") {
+    application();
+
+    // application() already ran initialize(): only descriptors were registered
+    const qint64 registrationUs = TreeSitterManager::instance().initializeTimeUs();
+
+    QElapsedTimer timer;
+    timer.start();
+    auto language = TreeSitterManager::instance().getLanguage("rust");
+    const qint64 firstUseUs = timer.nsecsElapsed() / 1000;
+    REQUIRE(language);
+    REQUIRE(language->highlightQuery);
+
+    std::cout << "startup registration " << registrationUs << " us; compiling rust queries on first use "
+              << firstUseUs << " us (compile " << language->queryCompileMs << " ms)\n";
+
+    CHECK(registrationUs < 1000);
+}
+
+TEST_CASE("Highlighter memory per document and resume cost", "[.][benchmark][highlighter]") {
+    application();
+
+    constexpr int kDocuments = 8;
+    std::vector<std::unique_ptr<QTextDocument>> documents;
+    std::vector<std::unique_ptr<TreeSitterHighlighter>> highlighters;
+    for (int i = 0; i < kDocuments; ++i) {
+        documents.push_back(std::make_unique<QTextDocument>());
+        documents.back()->setPlainText(generateSource(1024 * 1024));
+        documents.back()->setMetaInformation(QTextDocument::DocumentUrl, QStringLiteral("doc%1.cpp").arg(i));
+        highlighters.push_back(std::make_unique<TreeSitterHighlighter>(documents.back().get()));
+        REQUIRE(highlighters.back()->setLanguage("cpp"));
+        waitForParse(*highlighters.back());
+    }
+
+    HighlightBudget &budget = HighlightBudget::instance();
+    const size_t perDocument = highlighters.back()->memoryUsage();
+    const size_t unlimited = budget.totalBytes();
+    std::cout << "highlighter memory: " << perDocument / 1024 << " KiB per 1 MiB document, "
+              << unlimited / 1024 << " KiB for " << kDocuments << " documents\n";
+
+    // Room for about three documents
+    const int budgetMB = std::max<int>(1, static_cast<int>(3 * perDocument / (1024 * 1024)));
+    CodeWizard::Core::Config::instance().setInt(HighlightBudget::kConfigKey, budgetMB);
+    budget.touch(highlighters.back().get());
+
+    for (const DocumentMemory &entry : budget.report()) {
+        std::cout << "  " << entry.document.toStdString() << " " << entry.bytes / 1024 << " KiB"
+                  << (entry.suspended ? " (suspended)" : "") << "\n";
+    }
+
+    // Focusing a suspended document costs one full parse
+    QElapsedTimer timer;
+    timer.start();
+    budget.touch(highlighters.front().get());
+    waitForParse(*highlighters.front());
+    std::cout << "resuming a suspended document took " << timer.elapsed() << " ms\n";
+
+    CodeWizard::Core::Config::instance().setInt(HighlightBudget::kConfigKey, HighlightBudget::kDefaultBudgetMB);
+}
+
+// Compare separate builds: the old per-block capture logging corresponds to
+// trace level 2 with the category on. Run this case in a build configured with
+// -DCODEWIZARD_HIGHLIGHT_TRACE_LEVEL=2 and in a default (level 0) build.
+TEST_CASE("Highlighter tracing cost per trace level", "[.][benchmark][highlighter]") {
+    application();
+
+    // Comment-heavy text: the lines the old per-block debug output fired on
+    QTextDocument document;
+    document.setPlainText(generateSource(2 * 1024 * 1024));
+    TreeSitterHighlighter highlighter(&document);
+    REQUIRE(highlighter.setLanguage("cpp"));
+    waitForParse(highlighter);
+    REQUIRE(highlighter.isHealthy());
+
+    struct Pass {
+        qint64 ms;
+        double allocationsPerBlock;
+    };
+    auto measure = [&]() {
+        highlighter.resetStatistics();
+        const size_t before = threadAllocations().count;
+        QElapsedTimer timer;
+        timer.start();
+        highlighter.rehighlight();
+        const qint64 ms = timer.elapsed();
+        const int blocks = std::max(highlighter.statistics().highlightBlockCalls, 1);
+        return Pass{ ms, static_cast<double>(threadAllocations().count - before) / blocks };
+    };
+
+    QLoggingCategory::setFilterRules(QStringLiteral("codewizard.editor.highlighter.debug=false"));
+    const Pass off = measure();
+
+    // Traces compiled in run their formatting when enabled; swallow the output
+    QLoggingCategory::setFilterRules(QStringLiteral("codewizard.editor.highlighter.debug=true"));
+    const QtMessageHandler previous = qInstallMessageHandler([](QtMsgType, const QMessageLogContext &, const QString &) {});
+    const Pass on = measure();
+    qInstallMessageHandler(previous);
+    QLoggingCategory::setFilterRules(QStringLiteral("codewizard.editor.highlighter.debug=false"));
+
+    std::cout << "highlight pass over " << document.blockCount() << " blocks at trace level "
+              << CODEWIZARD_HIGHLIGHT_TRACE_LEVEL << ": category off " << off.ms << " ms, " << off.allocationsPerBlock
+              << " allocations/block; category on " << on.ms << " ms, " << on.allocationsPerBlock
+              << " allocations/block\n";
+}
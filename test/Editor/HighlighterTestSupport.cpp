@@ -0,0 +1,70 @@
+#include "HighlighterTestSupport.h"
+#include <Editor/TreeSitterManager.h>
+#include <QApplication>
+#include <QEventLoop>
+#include <QTimer>
+#include <cstdlib>
+#include <new>
+
+// Allocation counters: every operator new in the binary is counted per
+// thread, so a test can see the memory traffic of the UI thread alone
+namespace {
+thread_local CodeWizard::Editor::Testing::AllocationCounts t_allocations;
+} // namespace
+
+void *operator new(std::size_t size)
+{
+    ++t_allocations.count;
+    t_allocations.bytes += size;
+    if (void *p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+namespace CodeWizard::Editor::Testing {
+
+AllocationCounts threadAllocations() { return t_allocations; }
+
+void application()
+{
+    static int argc = 1;
+    static char name[] = "EditorTests";
+    static char *argv[] = { name, nullptr };
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+    static QApplication app(argc, argv);
+    static bool initialized = [] {
+        TreeSitterManager::instance().initialize(CODEWIZARD_QUERIES_DIR);
+        return true;
+    }();
+    (void)initialized;
+}
+
+QString generateSource(qsizetype bytes)
+{
+    static const QString unit = QStringLiteral(
+        "// Résumé of the ∑ accumulator\n"
+        "namespace demo {\n"
+        "struct Accumulator {\n"
+        "  int m_total = 0; /* running “total” */\n"
+        "  void add(int value) { m_total += value * 2; }\n"
+        "  const char *name() const { return \"accumulator – ünïcode\"; }\n"
+        "};\n"
+        "} // namespace demo\n");
+    const qsizetype unitBytes = unit.toUtf8().size();
+    QString source;
+    source.reserve(bytes + unit.size());
+    for (qsizetype written = 0; written < bytes; written += unitBytes) source += unit;
+    return source;
+}
+
+void waitForParse(TreeSitterHighlighter &highlighter)
+{
+    QEventLoop loop;
+    QObject::connect(&highlighter, &TreeSitterHighlighter::parsingFinished, &loop, &QEventLoop::quit);
+    QTimer::singleShot(30'000, &loop, &QEventLoop::quit);
+    loop.exec();
+}
+
+} // namespace CodeWizard::Editor::Testing
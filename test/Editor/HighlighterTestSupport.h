@@ -0,0 +1,28 @@
+#pragma once
+#include <Editor/TreeSitterHighlighter.h>
+#include <QString>
+#include <cstddef>
+
+// Fixture shared by EditorTests and EditorBenchmarks. Linking
+// HighlighterTestSupport.cpp replaces the binary's global operator new
+// with a counting one.
+namespace CodeWizard::Editor::Testing {
+
+// Calls to operator new and bytes requested by the calling thread so far
+struct AllocationCounts {
+    size_t count = 0;
+    size_t bytes = 0;
+};
+AllocationCounts threadAllocations();
+
+// Widgets need an application object; runs headless, with the source tree's queries
+void application();
+
+// C++ source of roughly `bytes` bytes, eight lines per repetition, with
+// comments, strings and non-ASCII text
+QString generateSource(qsizetype bytes);
+
+// Parsing runs on the thread pool: spin the event loop until the result is in
+void waitForParse(TreeSitterHighlighter &highlighter);
+
+} // namespace CodeWizard::Editor::Testing
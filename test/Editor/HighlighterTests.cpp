@@ -0,0 +1,251 @@
+#include "HighlighterTestSupport.h"
+#include <catch2/catch_test_macros.hpp>
+#include <Core/Config.h>
+#include <Editor/HighlightBudget.h>
+#include <Editor/TreeSitterHighlighter.h>
+#include <Editor/TreeSitterManager.h>
+#include <QApplication>
+#include <QEventLoop>
+#include <QTextBlock>
+#include <QTextCursor>
+#include <QTextDocument>
+#include <QTextLayout>
+#include <QTimer>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace CodeWizard::Editor;
+using namespace CodeWizard::Editor::Testing;
+
+namespace {
+
+bool isFormatted(const QTextBlock &block) { return !block.layout()->formats().isEmpty(); }
+
+} // namespace
+
+TEST_CASE("Highlighter reformats only the blocks a keystroke changed", "[editor][highlighter]") {
+    application();
+
+    QTextDocument document;
+    document.setPlainText(generateSource(64 * 1024));
+    TreeSitterHighlighter highlighter(&document);
+    REQUIRE(highlighter.setLanguage("cpp"));
+    waitForParse(highlighter);
+    REQUIRE(highlighter.isHealthy());
+    const int blockCount = document.blockCount();
+    REQUIRE(blockCount > 1000);
+
+    // Type one character in the middle of an identifier
+    QTextCursor cursor(document.findBlockByNumber(blockCount / 2 + 4));
+    cursor.movePosition(QTextCursor::EndOfWord);
+    highlighter.resetStatistics();
+    cursor.insertText("x");
+    waitForParse(highlighter);
+
+    const HighlightStatistics stats = highlighter.statistics();
+    REQUIRE(stats.incrementalParseCount == 1);
+    REQUIRE(stats.lastRehighlightedBlocks < 100);
+    REQUIRE(stats.highlightBlockCalls < 100);
+    REQUIRE(isFormatted(document.findBlockByNumber(blockCount / 2 + 4)));
+}
+
+TEST_CASE("Highlighter keystrokes do not copy the document", "[editor][highlighter]") {
+    application();
+
+    // Bytes allocated on the UI thread by one keystroke (excluding the background parse)
+    auto bytesPerKeystroke = [](qsizetype documentBytes) {
+        QTextDocument document;
+        document.setPlainText(generateSource(documentBytes));
+        TreeSitterHighlighter highlighter(&document);
+        REQUIRE(highlighter.setLanguage("cpp"));
+        waitForParse(highlighter);
+        REQUIRE(highlighter.isHealthy());
+
+        QTextCursor cursor(document.findBlockByNumber(document.blockCount() / 2));
+        cursor.movePosition(QTextCursor::EndOfWord);
+
+        constexpr int kKeystrokes = 32;
+        const size_t before = threadAllocations().bytes;
+        for (int i = 0; i < kKeystrokes; ++i) cursor.insertText("x");
+        const size_t perKeystroke = (threadAllocations().bytes - before) / kKeystrokes;
+        waitForParse(highlighter);
+        return perKeystroke;
+    };
+
+    const size_t small = bytesPerKeystroke(128 * 1024);
+    const size_t large = bytesPerKeystroke(1024 * 1024);
+
+    // A full copy of the text would cost a megabyte per keystroke
+    REQUIRE(large < 2 * small + 64 * 1024);
+    REQUIRE(large < 512 * 1024);
+}
+
+TEST_CASE("Lazy highlighting formats the visible window first", "[editor][highlighter]") {
+    application();
+
+    QTextDocument document;
+    document.setPlainText(generateSource(256 * 1024));
+    TreeSitterHighlighter highlighter(&document);
+    highlighter.setLazyHighlighting(true);
+    highlighter.setVisibleBlocks(0, 60);
+    REQUIRE(highlighter.setLanguage("cpp"));
+    waitForParse(highlighter);
+    REQUIRE(highlighter.isHealthy());
+    const int blockCount = document.blockCount();
+    REQUIRE(blockCount > 5000);
+
+    // The window plus its margin, nothing near the end
+    REQUIRE(highlighter.statistics().highlightBlockCalls <= 300);
+    REQUIRE(isFormatted(document.findBlockByNumber(2)));
+    REQUIRE_FALSE(isFormatted(document.findBlockByNumber(blockCount - 6)));
+
+    // Moving the window formats the blocks that came into view
+    highlighter.setVisibleBlocks(blockCount - 60, blockCount - 1);
+    REQUIRE(isFormatted(document.findBlockByNumber(blockCount - 6)));
+
+    // Idle slices fill in the rest
+    QEventLoop loop;
+    QTimer poll;
+    QObject::connect(&poll, &QTimer::timeout, &loop, [&]() {
+        if (highlighter.statistics().backfilledBlocks + 300 >= blockCount) loop.quit();
+    });
+    poll.start(10);
+    QTimer::singleShot(30'000, &loop, &QEventLoop::quit);
+    loop.exec();
+    REQUIRE(highlighter.statistics().backfilledBlocks + 300 >= blockCount);
+    REQUIRE(isFormatted(document.findBlockByNumber(blockCount / 2 + 4)));
+}
+
+TEST_CASE("Lazy highlighting leaves blocks hidden between visible runs alone", "[editor][highlighter]") {
+    application();
+
+    QTextDocument document;
+    document.setPlainText(generateSource(256 * 1024));
+    TreeSitterHighlighter highlighter(&document);
+    highlighter.setLazyHighlighting(true);
+    // A collapsed fold hides everything between the two runs
+    highlighter.setVisibleRanges({ { 0, 10 }, { 3000, 3040 } });
+    REQUIRE(highlighter.setLanguage("cpp"));
+    waitForParse(highlighter);
+    REQUIRE(highlighter.isHealthy());
+
+    REQUIRE(highlighter.statistics().highlightBlockCalls <= 300);
+    REQUIRE(isFormatted(document.findBlockByNumber(5)));
+    REQUIRE(isFormatted(document.findBlockByNumber(3020)));
+    REQUIRE_FALSE(isFormatted(document.findBlockByNumber(1500)));
+}
+
+TEST_CASE("Highlighter compiles a language's queries on first use", "[editor][highlighter]") {
+    application();
+
+    auto language = TreeSitterManager::instance().getLanguage("rust");
+    REQUIRE(language);
+    REQUIRE(language->highlightQuery);
+    REQUIRE(TreeSitterManager::instance().getLanguage("rust") == language);
+    REQUIRE(TreeSitterManager::instance().getLanguage("no-such-language") == nullptr);
+}
+
+TEST_CASE("Highlighter keeps injected layers a keystroke does not touch", "[editor][highlighter]") {
+    application();
+
+    // Every macro body is an injected Rust region
+    constexpr int kFunctions = 200;
+    QString source;
+    for (int i = 0; i < kFunctions; ++i) {
+        source += QStringLiteral("fn f%1() {\n    println!(\"{} {}\", %1, vec![1, 2, %1].len());\n}\n").arg(i);
+    }
+    QTextDocument document;
+    document.setPlainText(source);
+    TreeSitterHighlighter highlighter(&document);
+    REQUIRE(highlighter.setLanguage("rust"));
+    waitForParse(highlighter);
+    REQUIRE(highlighter.isHealthy());
+
+    const int layers = highlighter.statistics().injectionLayers;
+    REQUIRE(layers >= kFunctions);
+
+    // Inside the vec! literal of one function
+    QTextCursor cursor(document.findBlockByNumber(3 * (kFunctions / 2) + 1));
+    cursor.movePosition(QTextCursor::EndOfBlock);
+    cursor.movePosition(QTextCursor::Left, QTextCursor::MoveAnchor, 3);
+    cursor.insertText("0");
+    waitForParse(highlighter);
+
+    const HighlightStatistics stats = highlighter.statistics();
+    REQUIRE(stats.injectionLayers >= layers);
+    REQUIRE(stats.injectionReparses >= 1);
+    REQUIRE(stats.injectionReparses <= 4);
+}
+
+TEST_CASE("Highlighter drops a parse result that arrives after suspend", "[editor][highlighter]") {
+    application();
+
+    QTextDocument document;
+    document.setPlainText(generateSource(64 * 1024));
+    TreeSitterHighlighter highlighter(&document);
+    REQUIRE(highlighter.setLanguage("cpp"));
+    waitForParse(highlighter);
+    REQUIRE(highlighter.isHealthy());
+
+    // Let the job finish and queue its result while this thread does not
+    // process events, then suspend before the result is delivered
+    int finished = 0;
+    QObject::connect(&highlighter, &TreeSitterHighlighter::parsingFinished, [&finished]() { ++finished; });
+    highlighter.forceReparse();
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    highlighter.suspend();
+    QCoreApplication::processEvents();
+    QCoreApplication::processEvents();
+
+    REQUIRE(finished == 0);
+    REQUIRE(highlighter.isSuspended());
+    REQUIRE_FALSE(highlighter.isHealthy());
+    REQUIRE(highlighter.buffer().length() == 0);
+
+    // Resuming parses again, over the rebuilt buffer
+    highlighter.resume();
+    waitForParse(highlighter);
+    REQUIRE(highlighter.isHealthy());
+    REQUIRE(highlighter.buffer().length() > 0);
+}
+
+TEST_CASE("Highlight budget suspends the least recently focused documents", "[editor][highlighter]") {
+    application();
+
+    constexpr int kDocuments = 6;
+    std::vector<std::unique_ptr<QTextDocument>> documents;
+    std::vector<std::unique_ptr<TreeSitterHighlighter>> highlighters;
+    for (int i = 0; i < kDocuments; ++i) {
+        documents.push_back(std::make_unique<QTextDocument>());
+        documents.back()->setPlainText(generateSource(512 * 1024));
+        documents.back()->setMetaInformation(QTextDocument::DocumentUrl, QStringLiteral("doc%1.cpp").arg(i));
+        highlighters.push_back(std::make_unique<TreeSitterHighlighter>(documents.back().get()));
+        REQUIRE(highlighters.back()->setLanguage("cpp"));
+        waitForParse(*highlighters.back());
+        REQUIRE(highlighters.back()->isHealthy());
+    }
+
+    // Room for about three documents
+    HighlightBudget &budget = HighlightBudget::instance();
+    const size_t perDocument = highlighters.back()->memoryUsage();
+    const int budgetMB = std::max<int>(1, static_cast<int>(3 * perDocument / (1024 * 1024)));
+    CodeWizard::Core::Config::instance().setInt(HighlightBudget::kConfigKey, budgetMB);
+    budget.touch(highlighters.back().get());
+
+    CHECK(budget.totalBytes() <= budget.budgetBytes());
+    CHECK(highlighters.front()->isSuspended());
+    CHECK_FALSE(highlighters.back()->isSuspended());
+    CHECK(budget.report().front().document == QStringLiteral("doc%1.cpp").arg(kDocuments - 1));
+
+    // Focusing a suspended document brings its highlighting back
+    budget.touch(highlighters.front().get());
+    CHECK_FALSE(highlighters.front()->isSuspended());
+    waitForParse(*highlighters.front());
+    CHECK(highlighters.front()->isHealthy());
+    CHECK(budget.totalBytes() <= budget.budgetBytes());
+
+    CodeWizard::Core::Config::instance().setInt(HighlightBudget::kConfigKey, HighlightBudget::kDefaultBudgetMB);
+}
@@ -0,0 +1,129 @@
+#include <catch2/catch_test_macros.hpp>
+#include <Editor/LineIndex.h>
+#include <string>
+
+using namespace CodeWizard::Editor;
+
+TEST_CASE("Line index finds indexed lines", "[editor][lineindex]") {
+    const std::string text = "alpha\r\nbeta\n\ngamma";
+    LineIndex index(text);
+    REQUIRE_FALSE(index.isComplete());
+
+    // Lookups never scan ahead of the index
+    REQUIRE(index.lineAt(index.lineStart(0)) == "alpha");
+    REQUIRE(index.lineStart(1) == LineIndex::npos);
+    REQUIRE(index.indexedBytes() == 0);
+
+    REQUIRE(index.buildSome(text.size()));
+    REQUIRE(index.lineAt(index.lineStart(1)) == "beta");
+    REQUIRE(index.lineAt(index.lineStart(2)).empty());
+    REQUIRE(index.lineAt(index.lineStart(3)) == "gamma");
+    REQUIRE(index.lineStart(4) == LineIndex::npos);
+
+    REQUIRE(index.isComplete());
+    REQUIRE(index.lineCount() == 4);
+    REQUIRE(index.nextLineStart(index.lineStart(3)) == LineIndex::npos);
+}
+
+TEST_CASE("Line index builds in slices across checkpoints", "[editor][lineindex]") {
+    std::string text;
+    for (int i = 0; i < 1000; ++i) text += "line " + std::to_string(i) + "\n";
+    LineIndex index(text);
+
+    // The estimate from a partial scan is close to the truth
+    index.buildSome(text.size() / 4);
+    REQUIRE_FALSE(index.isComplete());
+    REQUIRE(index.lineCount() > 900);
+    REQUIRE(index.lineCount() < 1100);
+
+    while (!index.buildSome(1000)) {}
+    REQUIRE(index.lineCount() == 1001); // The final line feed starts an empty line
+    for (size_t line : { size_t(0), LineIndex::kStride - 1, LineIndex::kStride, size_t(999) }) {
+        REQUIRE(index.lineAt(index.lineStart(line)) == "line " + std::to_string(line));
+    }
+    REQUIRE(index.lineAt(index.lineStart(1000)).empty());
+}
+
+TEST_CASE("Line index estimates lines past the indexed part", "[editor][lineindex]") {
+    std::string text;
+    for (int i = 0; i < 1000; ++i) text += "line " + std::to_string(1000 + i) + "\n";
+    LineIndex index(text);
+    index.buildSome(text.size() / 4);
+    REQUIRE_FALSE(index.isLineIndexed(800));
+
+    // Equal line lengths: the estimate lands on a line start near the real one
+    const size_t start = index.estimatedLineStart(800);
+    REQUIRE(start != LineIndex::npos);
+    REQUIRE(start > index.indexedBytes());
+    REQUIRE(text[start - 1] == '\n');
+    const int estimated = std::stoi(std::string(index.lineAt(start).substr(5))) - 1000;
+    REQUIRE(estimated > 780);
+    REQUIRE(estimated < 820);
+    REQUIRE(index.indexedBytes() < text.size()); // Still not scanned
+
+    // Past the end: the last line
+    REQUIRE(index.lineAt(index.estimatedLineStart(5000)).empty());
+
+    while (!index.buildSome(1000)) {}
+    REQUIRE(index.estimatedLineStart(800) == index.lineStart(800));
+    REQUIRE(index.lineAt(index.lineStart(800)) == "line 1800");
+}
+
+TEST_CASE("Line index finds UTF-16 line feeds only on code unit boundaries", "[editor][lineindex]") {
+    // U+0A41 and U+410A contain a 0x0A byte that is not a line feed
+    const std::u16string lines = u"aੁb\r\n䄊c\nlast";
+    for (const auto unit : { LineIndex::CodeUnit::Utf16LE, LineIndex::CodeUnit::Utf16BE }) {
+        std::string bytes;
+        for (char16_t c : lines) {
+            const char low = static_cast<char>(c & 0xFF);
+            const char high = static_cast<char>(c >> 8);
+            if (unit == LineIndex::CodeUnit::Utf16LE) {
+                bytes += low;
+                bytes += high;
+            } else {
+                bytes += high;
+                bytes += low;
+            }
+        }
+        LineIndex index(bytes, unit);
+        // Odd slices split code units (and line feeds) between two calls
+        while (!index.buildSome(3)) {}
+        REQUIRE(index.lineCount() == 3);
+        REQUIRE(index.lineAt(index.lineStart(0)) == std::string_view(bytes).substr(0, 6)); // Without \r\n
+        REQUIRE(index.lineStart(1) == 10);
+        REQUIRE(index.lineAt(index.lineStart(1)).size() == 4);
+        REQUIRE(index.lineAt(index.lineStart(2)).size() == 8);
+        REQUIRE(index.nextLineStart(index.lineStart(2)) == LineIndex::npos);
+    }
+}
+
+TEST_CASE("Line index reads over-long lines a piece at a time", "[editor][lineindex]") {
+    const std::string text = std::string(10, 'x') + "\r\n" + std::string(8, 'y') + "\nend";
+    LineIndex index(text);
+
+    // Cut every four bytes; the rest of the line continues where the cut was
+    REQUIRE(index.lineAt(0, 4) == "xxxx");
+    REQUIRE(index.nextLineStart(0, 4) == 4);
+    REQUIRE_FALSE(index.isLineStart(4));
+    REQUIRE(index.lineAt(8, 4) == "xx");
+    REQUIRE(index.nextLineStart(8, 4) == 12);
+    REQUIRE(index.isLineStart(12));
+
+    // A line break right at the limit still ends the line
+    REQUIRE(index.lineAt(12, 8) == std::string(8, 'y'));
+    REQUIRE(index.nextLineStart(12, 8) == 21);
+    REQUIRE(index.lineAt(21, 4) == "end");
+    REQUIRE(index.nextLineStart(21, 4) == LineIndex::npos);
+
+    // The same in UTF-16: cuts stay on code unit boundaries
+    std::string utf16;
+    for (char c : text) {
+        utf16 += c;
+        utf16 += '\0';
+    }
+    LineIndex wide(utf16, LineIndex::CodeUnit::Utf16LE);
+    REQUIRE(wide.nextLineStart(0, 9) == 8);
+    REQUIRE(wide.lineAt(16, 8).size() == 4);
+    REQUIRE(wide.nextLineStart(16, 8) == 24);
+    REQUIRE(wide.isLineStart(24));
+}
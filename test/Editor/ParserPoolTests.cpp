@@ -0,0 +1,57 @@
+#include <catch2/catch_test_macros.hpp>
+#include <Editor/ParserPool.h>
+#include <cstring>
+
+extern "C" const TSLanguage *tree_sitter_cpp();
+
+using namespace CodeWizard::Editor;
+
+TEST_CASE("ParserPool reuses returned parsers", "[editor][parserpool]") {
+    ParserPool &pool = ParserPool::instance();
+    pool.trim();
+    const ParserPoolStatistics before = pool.statistics();
+
+    TSParser *first = nullptr;
+    {
+        ParserLease a = pool.acquireParser(tree_sitter_cpp());
+        ParserLease b = pool.acquireParser(tree_sitter_cpp());
+        REQUIRE(a);
+        REQUIRE(b);
+        REQUIRE(a.get() != b.get());
+        REQUIRE(pool.statistics().parsersInUse == before.parsersInUse + 2);
+        first = a.get();
+    }
+
+    const ParserPoolStatistics idle = pool.statistics();
+    REQUIRE(idle.parsersInUse == before.parsersInUse);
+    REQUIRE(idle.parsersIdle == 2);
+
+    // The next borrower gets a pooled parser, already set to the language
+    ParserLease again = pool.acquireParser(tree_sitter_cpp());
+    REQUIRE(again.get() == first);
+    const char source[] = "int main() { return 0; }";
+    TSTree *tree = ts_parser_parse_string(again.get(), nullptr, source, static_cast<uint32_t>(std::strlen(source)));
+    REQUIRE(tree);
+    REQUIRE_FALSE(ts_node_has_error(ts_tree_root_node(tree)));
+    ts_tree_delete(tree);
+}
+
+TEST_CASE("ParserPool caps idle objects and trims them", "[editor][parserpool]") {
+    ParserPool &pool = ParserPool::instance();
+    pool.trim();
+    pool.setMaxIdle(1, 1);
+
+    {
+        CursorLease a = pool.acquireCursor();
+        CursorLease b = pool.acquireCursor();
+        CursorLease moved = std::move(b);
+        REQUIRE_FALSE(b);
+        REQUIRE(pool.statistics().cursorsInUse == 2);
+    }
+    REQUIRE(pool.statistics().cursorsInUse == 0);
+    REQUIRE(pool.statistics().cursorsIdle == 1);
+
+    pool.trim();
+    REQUIRE(pool.statistics().cursorsIdle == 0);
+    pool.setMaxIdle(2, 4);
+}
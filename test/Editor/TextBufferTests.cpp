@@ -1,5 +1,7 @@
 #include <catch2/catch_test_macros.hpp>
 #include <Editor/TextBuffer.h>
+#include <algorithm>
+#include <string>
 
 using namespace CodeWizard::Editor;
 
@@ -20,3 +22,156 @@ TEST_CASE("TextBuffer position conversion", "[editor][textbuffer]") {
     auto offset = buffer.offsetFromPosition({1, 1});
     REQUIRE(offset == 7);
 }
+
+TEST_CASE("TextBuffer insert and remove", "[editor][textbuffer]") {
+    TextBuffer buffer("hello world");
+    buffer.insert(5, ",");
+    REQUIRE(buffer.text() == "hello, world");
+
+    buffer.insert(buffer.length(), "\nsecond");
+    REQUIRE(buffer.lineCount() == 2);
+    REQUIRE(buffer.line(1) == "second");
+
+    buffer.remove(0, 7);
+    REQUIRE(buffer.text() == "world\nsecond");
+    REQUIRE(buffer.line(0) == "world");
+
+    buffer.remove(5, 1);
+    REQUIRE(buffer.lineCount() == 1);
+    REQUIRE(buffer.text() == "worldsecond");
+}
+
+TEST_CASE("TextBuffer line index follows edits", "[editor][textbuffer]") {
+    TextBuffer buffer("a\nb\nc");
+    buffer.insert(2, "x\ny\n"); // a\nx\ny\nb\nc
+    REQUIRE(buffer.lineCount() == 5);
+    REQUIRE(buffer.line(1) == "x");
+    REQUIRE(buffer.line(3) == "b");
+    REQUIRE(buffer.lineStart(4) == 8);
+
+    auto pos = buffer.positionFromOffset(6);
+    REQUIRE(pos.line == 3);
+    REQUIRE(pos.character == 0);
+    REQUIRE(buffer.offsetFromPosition({3, 0}) == 6);
+
+    // Characters past the end of a line clamp to the line end
+    REQUIRE(buffer.offsetFromPosition({0, 10}) == 1);
+}
+
+TEST_CASE("TextBuffer matches std::string under random edits", "[editor][textbuffer]") {
+    std::string reference = "int main() {\n  return 0;\n}\n";
+    TextBuffer buffer(reference);
+
+    uint32_t seed = 12345;
+    auto next = [&seed](uint32_t bound) {
+        seed = seed * 1103515245u + 12345u;
+        return (seed >> 8) % bound;
+    };
+
+    for (int i = 0; i < 2000; ++i) {
+        if (next(3) != 0 || reference.empty()) {
+            const size_t offset = next(static_cast<uint32_t>(reference.size() + 1));
+            const std::string text = (next(4) == 0) ? "\n" : std::string(next(6) + 1, static_cast<char>('a' + next(26)));
+            reference.insert(offset, text);
+            buffer.insert(offset, text);
+        } else {
+            const size_t offset = next(static_cast<uint32_t>(reference.size()));
+            const size_t length = next(8) + 1;
+            reference.erase(offset, length);
+            buffer.remove(offset, length);
+        }
+    }
+
+    REQUIRE(buffer.text() == reference);
+    REQUIRE(buffer.lineCount() == std::count(reference.begin(), reference.end(), '\n') + 1);
+
+    size_t lineStart = 0;
+    for (uint32_t line = 0; line < buffer.lineCount(); ++line) {
+        REQUIRE(buffer.lineStart(line) == lineStart);
+        size_t end = reference.find('\n', lineStart);
+        if (end == std::string::npos) end = reference.size();
+        REQUIRE(buffer.line(line) == reference.substr(lineStart, end - lineStart));
+        lineStart = end + 1;
+    }
+}
+
+TEST_CASE("TextBuffer positions match a newline scan", "[editor][textbuffer]") {
+    std::string reference;
+    for (int i = 0; i < 5000; ++i) reference += "line " + std::to_string(i) + (i % 7 == 0 ? "\n\n" : "\n");
+    TextBuffer buffer(reference);
+
+    // Edits near the end of the text, as in long generated files
+    for (int i = 0; i < 50; ++i) {
+        const size_t offset = reference.size() - static_cast<size_t>(i) * 37;
+        const std::string text = i % 3 == 0 ? "\nx" : "yz";
+        reference.insert(offset, text);
+        buffer.insert(offset, text);
+    }
+
+    for (size_t offset = 0; offset <= reference.size(); offset += 97) {
+        const size_t row = static_cast<size_t>(std::count(reference.begin(), reference.begin() + static_cast<std::ptrdiff_t>(offset), '\n'));
+        const size_t lineStart = offset == 0 ? 0 : reference.rfind('\n', offset - 1) + 1;
+        const auto pos = buffer.positionFromOffset(offset);
+        REQUIRE(pos.line == row);
+        REQUIRE(pos.character == offset - lineStart);
+    }
+}
+
+TEST_CASE("TextBuffer copies are independent snapshots", "[editor][textbuffer]") {
+    TextBuffer buffer("alpha\nbeta");
+    TextBuffer snapshot = buffer;
+
+    buffer.insert(0, "zero\n");
+    buffer.remove(buffer.length() - 4, 4);
+    snapshot.insert(snapshot.length(), "!");
+
+    REQUIRE(buffer.text() == "zero\nalpha\n");
+    REQUIRE(snapshot.text() == "alpha\nbeta!");
+}
+
+TEST_CASE("TextBuffer UTF-16 offset conversion", "[editor][textbuffer]") {
+    // a (1 byte, 1 unit), é (2, 1), € (3, 1), 😀 (4, 2)
+    const std::string sample = "a\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80\n";
+    std::string text;
+    for (int i = 0; i < 1000; ++i) text += sample; // spans several checkpoints
+
+    TextBuffer buffer(text);
+    REQUIRE(buffer.utf16Length() == 6000);
+    REQUIRE(buffer.offsetFromUtf16(1) == 1);
+    REQUIRE(buffer.offsetFromUtf16(3) == 6);
+    REQUIRE(buffer.offsetFromUtf16(5) == 10);
+    REQUIRE(buffer.utf16FromOffset(10) == 5);
+
+    // Every sample starts at byte 11 * n and unit 6 * n
+    for (size_t n = 0; n < 1000; n += 37) {
+        REQUIRE(buffer.offsetFromUtf16(6 * n) == 11 * n);
+        REQUIRE(buffer.utf16FromOffset(11 * n) == 6 * n);
+    }
+
+    buffer.insert(11 * 500, "\xC3\xA9xyz");
+    REQUIRE(buffer.utf16Length() == 6004);
+    REQUIRE(buffer.offsetFromUtf16(6 * 500 + 1) == 11 * 500 + 2);
+    REQUIRE(buffer.offsetFromUtf16(6 * 600 + 4) == 11 * 600 + 5);
+    REQUIRE(buffer.utf16FromOffset(11 * 600 + 5) == 6 * 600 + 4);
+
+    buffer.remove(0, 11);
+    REQUIRE(buffer.utf16Length() == 5998);
+    REQUIRE(buffer.offsetFromUtf16(6 * 10) == 11 * 10);
+}
+
+TEST_CASE("TextBuffer reports the memory it holds", "[editor][textbuffer]") {
+    TextBuffer empty;
+    const std::string text(256 * 1024, 'x');
+    TextBuffer buffer(text);
+    REQUIRE(buffer.memoryUsage() >= text.size());
+    REQUIRE(buffer.memoryUsage() > empty.memoryUsage());
+
+    // Small inserts land in a shared arena chunk, not one allocation each
+    const size_t before = buffer.memoryUsage();
+    for (int i = 0; i < 100; ++i) buffer.insert(static_cast<size_t>(i) * 1000, "y");
+    REQUIRE(buffer.memoryUsage() > before);
+    REQUIRE(buffer.memoryUsage() < before + 256 * 1024);
+
+    buffer.setText({});
+    REQUIRE(buffer.memoryUsage() < 1024);
+}
@@ -0,0 +1,43 @@
+#include <catch2/catch_test_macros.hpp>
+#include <Platform/AtomicFile.h>
+#include <Platform/FileSystem.h>
+#include <Platform/Path.h>
+#include <string>
+
+using namespace CodeWizard::Platform;
+
+TEST_CASE("Atomic write replaces the target only on commit", "[platform][atomicfile]") {
+    Path target("/tmp/codewizard_atomic_test.txt");
+    REQUIRE(writeFile(target, "original").hasValue());
+
+    std::string tempPath;
+    {
+        auto writer = AtomicFileWriter::create(target);
+        REQUIRE(writer.hasValue());
+        REQUIRE(writer.value().write("half a new ").hasValue());
+        tempPath = writer.value().tempPath();
+        REQUIRE(Path(tempPath).exists());
+        // Abandoned: the original stays and the temp file goes
+    }
+    REQUIRE_FALSE(Path(tempPath).exists());
+    REQUIRE(readFile(target).value() == "original");
+
+    auto writer = AtomicFileWriter::create(target);
+    REQUIRE(writer.hasValue());
+    const std::string big(300 * 1024, 'x'); // Larger than the write buffer
+    REQUIRE(writer.value().write("new ").hasValue());
+    REQUIRE(writer.value().write(big).hasValue());
+    REQUIRE(writer.value().write(" end").hasValue());
+    REQUIRE(readFile(target).value() == "original");
+    REQUIRE(writer.value().commit(SyncPolicy::Full).hasValue());
+    REQUIRE(writer.value().bytesWritten() == big.size() + 8);
+    REQUIRE(readFile(target).value() == "new " + big + " end");
+
+    (void)remove(target);
+}
+
+TEST_CASE("Sync policy names", "[platform][atomicfile]") {
+    REQUIRE(syncPolicyFromString("none") == SyncPolicy::None);
+    REQUIRE(syncPolicyFromString("full") == SyncPolicy::Full);
+    REQUIRE(syncPolicyFromString("bogus", SyncPolicy::Full) == SyncPolicy::Full);
+}
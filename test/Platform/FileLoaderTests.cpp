@@ -0,0 +1,45 @@
+#include <catch2/catch_test_macros.hpp>
+#include <Platform/FileLoader.h>
+#include <Platform/FileSystem.h>
+#include <Platform/Path.h>
+#include <string>
+
+using namespace CodeWizard::Platform;
+
+TEST_CASE("Encoding detection", "[platform][fileloader]") {
+    std::size_t bom = 0;
+    REQUIRE(detectEncoding("plain ascii", bom) == TextEncoding::Utf8);
+    REQUIRE(bom == 0);
+    REQUIRE(detectEncoding("\xEF\xBB\xBF" "caf\xC3\xA9", bom) == TextEncoding::Utf8);
+    REQUIRE(bom == 3);
+    REQUIRE(detectEncoding(std::string("\xFF\xFEh\0i\0", 6), bom) == TextEncoding::Utf16LE);
+    REQUIRE(bom == 2);
+    REQUIRE(detectEncoding(std::string("\0h\0e\0l\0l\0o", 10), bom) == TextEncoding::Utf16BE);
+    REQUIRE(bom == 0);
+    REQUIRE(detectEncoding("caf\xE9 au lait", bom) == TextEncoding::Latin1);
+}
+
+TEST_CASE("Loading reads once and reports line statistics", "[platform][fileloader]") {
+    Path tempFile("/tmp/codewizard_loader_test.txt");
+    REQUIRE(writeFile(tempFile, "\xEF\xBB\xBFshort\r\na much longer line\nend", WriteOption::Binary).hasValue());
+
+    auto loaded = loadFile(tempFile);
+    REQUIRE(loaded.hasValue());
+    const LoadedFile& file = loaded.value();
+    REQUIRE_FALSE(file.mapped);
+    REQUIRE(file.bomLength == 3);
+    REQUIRE(file.text() == "short\r\na much longer line\nend");
+    REQUIRE(file.lineCount == 3);
+    REQUIRE(file.longestLine == 18);
+    REQUIRE(file.metrics.bytes == file.size);
+
+    // Above the threshold the file is mapped instead of read
+    auto mapped = loadFile(tempFile, 8);
+    REQUIRE(mapped.hasValue());
+    REQUIRE(mapped.value().mapped);
+    REQUIRE(mapped.value().content.empty());
+    REQUIRE(mapped.value().text() == file.text());
+
+    remove(tempFile);
+    REQUIRE(loadFile(tempFile).hasError());
+}
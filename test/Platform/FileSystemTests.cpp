@@ -36,3 +36,17 @@ TEST_CASE("Directory listing", "[platform][filesystem]") {
 
     remove(tempDir, true);
 }
+
+TEST_CASE("File stat", "[platform][filesystem]") {
+    Path tempFile("/tmp/codewizard_stat_test.txt");
+    REQUIRE(writeFile(tempFile, "12345").hasValue());
+
+    auto info = stat(tempFile);
+    REQUIRE(info.hasValue());
+    REQUIRE(info.value().isFile);
+    REQUIRE_FALSE(info.value().isDirectory);
+    REQUIRE(info.value().size == 5);
+
+    remove(tempFile);
+    REQUIRE(stat(tempFile).hasError());
+}
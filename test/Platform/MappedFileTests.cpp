@@ -0,0 +1,41 @@
+#include <catch2/catch_test_macros.hpp>
+#include <Platform/FileSystem.h>
+#include <Platform/MappedFile.h>
+#include <Platform/Path.h>
+#include <string>
+
+using namespace CodeWizard::Platform;
+
+TEST_CASE("Mapped file exposes the file contents", "[platform][mappedfile]") {
+    Path tempFile("/tmp/codewizard_mapped_test.txt");
+    const std::string content = "first line\nsecond line\n";
+    REQUIRE(writeFile(tempFile, content, WriteOption::Binary).hasValue());
+
+    auto mapped = MappedFile::open(tempFile);
+    REQUIRE(mapped.hasValue());
+    REQUIRE(mapped.value().isOpen());
+    REQUIRE(mapped.value().view() == content);
+
+    // Ownership moves with the object; dropped pages read back unchanged
+    MappedFile moved = std::move(mapped).value();
+    moved.advise(MappedFile::Advice::DontNeed);
+    REQUIRE(moved.size() == content.size());
+    REQUIRE(moved.view() == content);
+
+    remove(tempFile);
+}
+
+TEST_CASE("Mapping empty and missing files", "[platform][mappedfile]") {
+    Path emptyFile("/tmp/codewizard_mapped_empty.txt");
+    REQUIRE(writeFile(emptyFile, "").hasValue());
+
+    auto empty = MappedFile::open(emptyFile);
+    REQUIRE(empty.hasValue());
+    REQUIRE(empty.value().isOpen());
+    REQUIRE(empty.value().view().empty());
+    remove(emptyFile);
+
+    auto missing = MappedFile::open(Path("/tmp/codewizard_mapped_missing.txt"));
+    REQUIRE(missing.hasError());
+    REQUIRE(missing.error().code() == CodeWizard::Core::ErrorCode::FileNotFound);
+}